@@ -0,0 +1,77 @@
+// ff.c - FatFs subset implemented over stdio for the host benchmark
+//
+#include <string.h>
+#include <sys/stat.h>
+#include "ff.h"
+
+FRESULT
+f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+	const char *fmode = "rb";
+
+	if (mode & FA_CREATE_ALWAYS)
+		fmode = (mode & FA_READ) ? "w+b" : "wb";
+	else if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND)
+		fmode = "ab";
+	else if (mode & FA_WRITE)
+		fmode = "r+b";
+
+	fp->fptr = 0;
+	fp->fp = fopen(path, fmode);
+
+	return fp->fp ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT
+f_close(FIL *fp)
+{
+	if (!fp->fp)
+		return FR_INVALID_OBJECT;
+	fclose(fp->fp);
+	fp->fp = NULL;
+	return FR_OK;
+}
+
+FRESULT
+f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+	*br = fread(buff, 1, btr, fp->fp);
+	fp->fptr += *br;
+	return ferror(fp->fp) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT
+f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+	*bw = fwrite(buff, 1, btw, fp->fp);
+	fp->fptr += *bw;
+	return (*bw == btw) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT
+f_lseek(FIL *fp, FSIZE_t ofs)
+{
+	if (fseek(fp->fp, (long)ofs, SEEK_SET) != 0)
+		return FR_DISK_ERR;
+	fp->fptr = ofs;
+	return FR_OK;
+}
+
+FRESULT
+f_stat(const TCHAR *path, FILINFO *fno)
+{
+	struct stat st;
+
+	if (stat(path, &st) != 0)
+		return FR_NO_FILE;
+
+	memset(fno, 0, sizeof(*fno));
+	fno->fsize = st.st_size;
+	fno->ftime = (WORD)st.st_mtime;
+	fno->fdate = (WORD)(st.st_mtime >> 16);
+
+	const char *name = strrchr(path, '/');
+	strncpy(fno->fname, name ? name + 1 : path, sizeof(fno->fname) - 1);
+
+	return FR_OK;
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Minimal FatFs API over stdio, just enough for the pce-go save states
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint64_t FSIZE_t;
+typedef char TCHAR;
+
+typedef enum {
+	FR_OK = 0,
+	FR_DISK_ERR,
+	FR_NO_FILE,
+	FR_INVALID_OBJECT,
+} FRESULT;
+
+typedef struct {
+	FILE *fp;
+	FSIZE_t fptr;
+} FIL;
+
+typedef struct {
+	FSIZE_t fsize;
+	WORD fdate;
+	WORD ftime;
+	BYTE fattrib;
+	TCHAR fname[256];
+} FILINFO;
+
+#define FA_READ             0x01
+#define FA_WRITE            0x02
+#define FA_OPEN_EXISTING    0x00
+#define FA_CREATE_NEW       0x04
+#define FA_CREATE_ALWAYS    0x08
+#define FA_OPEN_ALWAYS      0x10
+#define FA_OPEN_APPEND      0x30
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_stat(const TCHAR *path, FILINFO *fno);
+
+#define f_tell(fp) ((fp)->fptr)
@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in for drivers/graphics: the benchmark runs without a display
@@ -0,0 +1,22 @@
+#pragma once
+// Host stand-in for the few pico-sdk attributes used by the pce-go core
+
+#ifndef __time_critical_func
+#define __time_critical_func(func) func
+#endif
+
+#ifndef __not_in_flash_func
+#define __not_in_flash_func(func) func
+#endif
+
+#ifndef __aligned
+#define __aligned(x) __attribute__((aligned(x)))
+#endif
+
+#ifndef __always_inline
+#define __always_inline inline __attribute__((__always_inline__))
+#endif
+
+#ifndef tight_loop_contents
+static inline void tight_loop_contents(void) {}
+#endif
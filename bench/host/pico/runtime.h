@@ -0,0 +1,2 @@
+#pragma once
+// Intentionally empty: the host build has no pico runtime
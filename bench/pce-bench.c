@@ -0,0 +1,443 @@
+// pce-bench.c - Headless host benchmark for the pce-go core
+//
+// Runs N frames of pce_run() on a .pce image without any display or audio
+// device and reports emulation throughput, so regressions in h6280_run,
+// gfx_run and psg_update show up before anything is flashed to a board.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#if USE_RENDER_CORE
+#include <pthread.h>
+#endif
+
+#include "pce-go.h"
+#include "pce.h"
+#include "gfx.h"
+#include "psg.h"
+
+#define AUDIO_SAMPLE_RATE   22050
+#define AUDIO_BUFFER_LENGTH (AUDIO_SAMPLE_RATE / 60 + 1)
+
+uint8_t SCREEN[XBUF_HEIGHT][XBUF_WIDTH];
+static int16_t audio_buffer[AUDIO_BUFFER_LENGTH * 2];
+
+static const char *bench_names[BENCH_MAX] = { "cpu", "gfx", "psg" };
+static uint64_t bench_start[BENCH_MAX];
+static uint64_t bench_total[BENCH_MAX];
+static uint64_t bench_calls[BENCH_MAX];
+static uint64_t bench_stats[BENCH_STAT_MAX];
+#if ENABLE_BENCH_PAIRS
+static uint64_t bench_pairs[256][256];
+#endif
+#if USE_PSRAM_ROM
+#define PSRAM_SIZE (8 << 20)
+static uint8_t *psram;
+static uint64_t psram_reads, psram_writes;
+#endif
+
+
+static inline uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+void
+osd_bench_begin(int slot)
+{
+	bench_start[slot] = now_ns();
+}
+
+
+void
+osd_bench_end(int slot)
+{
+	bench_total[slot] += now_ns() - bench_start[slot];
+	bench_calls[slot]++;
+}
+
+
+void
+osd_bench_stat(int stat, uint32_t count)
+{
+	bench_stats[stat] += count;
+}
+
+
+#if ENABLE_BENCH_PAIRS
+void
+osd_bench_pair(uint8_t first, uint8_t second)
+{
+	bench_pairs[first][second]++;
+}
+
+
+/*
+	Most executed opcode pairs, candidates for h6280_fusetable.h
+*/
+static void
+print_pairs(int count)
+{
+	uint64_t total = 0;
+	for (int i = 0; i < 0x10000; i++) {
+		total += bench_pairs[i >> 8][i & 0xFF];
+	}
+
+	printf("top opcode pairs:\n");
+	for (int n = 0; n < count && total; n++) {
+		int best = 0;
+		for (int i = 1; i < 0x10000; i++) {
+			if (bench_pairs[i >> 8][i & 0xFF] > bench_pairs[best >> 8][best & 0xFF])
+				best = i;
+		}
+		uint64_t hits = bench_pairs[best >> 8][best & 0xFF];
+		if (!hits)
+			break;
+		printf("  %02X %02X  %5.2f%%\n", best >> 8, best & 0xFF, hits * 100.0 / total);
+		bench_pairs[best >> 8][best & 0xFF] = 0;
+	}
+}
+#endif
+
+
+uint8_t *
+osd_gfx_framebuffer(int width, int height)
+{
+	return (uint8_t *)SCREEN;
+}
+
+
+void
+osd_input_read(uint8_t joypads[8])
+{
+	memset(joypads, 0, 8);
+}
+
+
+void
+osd_vsync(void)
+{
+	//
+}
+
+
+#if USE_PSRAM_ROM
+void
+osd_psram_read(uint32_t addr, void *dst, size_t len)
+{
+	memcpy(dst, psram + addr, len);
+	psram_reads += len;
+}
+
+
+void
+osd_psram_write(uint32_t addr, const void *src, size_t len)
+{
+	memcpy(psram + addr, src, len);
+	psram_writes += len;
+}
+#endif
+
+
+/*
+	FNV-1a over the machine state, used to compare two builds of the core
+*/
+static uint32_t
+digest(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	while (len--) {
+		hash = (hash ^ *p++) * 16777619u;
+	}
+	return hash;
+}
+
+
+static uint32_t
+state_digest(void)
+{
+	uint32_t hash = 2166136261u;
+	hash = digest(hash, PCE.RAM, sizeof(PCE.RAM));
+	hash = digest(hash, PCE.VRAM, sizeof(PCE.VRAM));
+	hash = digest(hash, PCE.SPRAM, sizeof(PCE.SPRAM));
+	hash = digest(hash, PCE.Palette, sizeof(PCE.Palette));
+	hash = digest(hash, PCE.MMR, sizeof(PCE.MMR));
+	hash = digest(hash, &CPU.PC, sizeof(CPU.PC));
+	hash = digest(hash, &CPU.A, 5); // A, X, Y, P, S
+	hash = digest(hash, SCREEN, sizeof(SCREEN));
+	return hash;
+}
+
+
+static void *
+load_file(const char *path, size_t *size)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp) {
+		return NULL;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	*size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	void *buffer = malloc(*size);
+	if (buffer && fread(buffer, 1, *size, fp) != *size) {
+		free(buffer);
+		buffer = NULL;
+	}
+	fclose(fp);
+
+	return buffer;
+}
+
+
+#if USE_BEAM_RENDER
+// Stands in for the display driver, draws the frame a line at a time
+static void
+beam_scanout(void)
+{
+	osd_bench_begin(BENCH_GFX);
+	for (int y = 0; y < PCE.VDC.screen_height && y < XBUF_HEIGHT; y++)
+		memcpy(SCREEN[y], gfx_beam_line(y), XBUF_WIDTH);
+	osd_bench_end(BENCH_GFX);
+}
+#endif
+
+
+#if USE_RENDER_CORE
+static volatile bool render_thread_stop;
+
+// Stands in for core 1 of the firmware
+static void *
+render_thread(void *arg)
+{
+	while (!render_thread_stop)
+		gfx_render_journal();
+	return NULL;
+}
+#endif
+
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-n frames] [-w warmup] [-i] [-d] [-t] [-p profile.txt] [-g games.txt] rom.pce\n", name);
+	fprintf(stderr, "  -n frames   number of measured frames (default 3000)\n");
+	fprintf(stderr, "  -w warmup   frames to run before measuring (default 120)\n");
+	fprintf(stderr, "  -i          don't skip idle loops\n");
+	fprintf(stderr, "  -d          print the state digest after every frame\n");
+	fprintf(stderr, "  -t          render on a second thread (USE_RENDER_CORE builds)\n");
+	fprintf(stderr, "  -p file     save the profiler report (ENABLE_PROFILER builds)\n");
+	fprintf(stderr, "  -g file     load a game database, like \\PCE\\pce-games.txt\n");
+}
+
+
+int
+main(int argc, char **argv)
+{
+	int frames = 3000;
+	int warmup = 120;
+	bool idle_skip = true;
+	bool trace = false;
+	const char *profile = NULL;
+	const char *games = NULL;
+	bool threaded = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:w:idtp:g:h")) != -1) {
+		switch (opt) {
+		case 'n': frames = atoi(optarg); break;
+		case 'w': warmup = atoi(optarg); break;
+		case 'i': idle_skip = false; break;
+		case 'd': trace = true; break;
+		case 't': threaded = true; break;
+		case 'p': profile = optarg; break;
+		case 'g': games = optarg; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc || frames <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	size_t rom_size = 0;
+	void *rom = load_file(argv[optind], &rom_size);
+	if (!rom) {
+		fprintf(stderr, "Failed to load %s\n", argv[optind]);
+		return 1;
+	}
+
+	if (games && LoadGameDB(games) < 0) {
+		fprintf(stderr, "Failed to load %s\n", games);
+		return 1;
+	}
+
+#if USE_PSRAM_ROM
+	// The ROM is only read from PSRAM, like on a board without flash room
+	psram = calloc(1, PSRAM_SIZE);
+	if (!psram || rom_size > PSRAM_SIZE - PSRAM_CARD_RAM_SIZE) {
+		fprintf(stderr, "%s doesn't fit in PSRAM\n", argv[optind]);
+		return 1;
+	}
+	memcpy(psram, rom, rom_size);
+
+	if (InitPCE(AUDIO_SAMPLE_RATE, true, NULL, rom_size, 0, false)) {
+#else
+	if (InitPCE(AUDIO_SAMPLE_RATE, true, rom, rom_size, 0, false)) {
+#endif
+		fprintf(stderr, "Failed to initialize the emulator\n");
+		return 1;
+	}
+
+	PCE.IdleSkip &= idle_skip;
+
+#if USE_RENDER_CORE
+	pthread_t render_tid;
+	if (threaded) {
+		if (pthread_create(&render_tid, NULL, render_thread, NULL)) {
+			fprintf(stderr, "Failed to start the render thread\n");
+			return 1;
+		}
+		gfx_render_async(true);
+	}
+#else
+	if (threaded) {
+		fprintf(stderr, "warning: built without USE_RENDER_CORE, rendering inline\n");
+	}
+#endif
+
+	for (int i = 0; i < warmup; i++) {
+		pce_run();
+#if USE_BEAM_RENDER
+		beam_scanout();
+#endif
+		psg_update(audio_buffer, AUDIO_BUFFER_LENGTH, 0xff);
+	}
+
+	memset(bench_total, 0, sizeof(bench_total));
+	memset(bench_calls, 0, sizeof(bench_calls));
+	memset(bench_stats, 0, sizeof(bench_stats));
+#if ENABLE_BENCH_PAIRS
+	memset(bench_pairs, 0, sizeof(bench_pairs));
+#endif
+	PCE.IdleCycles = 0;
+	PCE.TileHits = PCE.TileMisses = 0;
+	PCE.SpriteHits = PCE.SpriteMisses = 0;
+	PCE.BankLoads = 0;
+#if USE_PSRAM_ROM
+	psram_reads = psram_writes = 0;
+#endif
+#if ENABLE_PROFILER
+	ResetProfile();
+#endif
+
+	uint64_t start = now_ns();
+
+	for (int i = 0; i < frames; i++) {
+		pce_run();
+#if USE_BEAM_RENDER
+		beam_scanout();
+#endif
+		osd_bench_begin(BENCH_PSG);
+		psg_update(audio_buffer, AUDIO_BUFFER_LENGTH, 0xff);
+		osd_bench_end(BENCH_PSG);
+		if (trace) {
+#if USE_RENDER_CORE
+			gfx_render_sync();
+#endif
+			printf("frame %d: %08X\n", i, state_digest());
+		}
+	}
+
+#if USE_RENDER_CORE
+	gfx_render_sync();
+#endif
+	uint64_t elapsed = now_ns() - start;
+	uint64_t lines = (uint64_t)frames * 263;
+	uint64_t samples = (uint64_t)frames * AUDIO_BUFFER_LENGTH;
+
+	printf("rom:          %s (%zu bytes, %d banks)\n", argv[optind], rom_size, PCE.ROM_SIZE);
+	printf("frames:       %d (+%d warmup)\n", frames, warmup);
+	printf("elapsed:      %.3f s\n", elapsed / 1e9);
+	printf("frames/sec:   %.1f (%.2fx realtime)\n", frames * 1e9 / elapsed, frames * 1e9 / elapsed / 60.0);
+	printf("render:       %s\n", USE_BEAM_RENDER ? "beam, after each frame" :
+		USE_RENDER_CORE && threaded ? "journal, second thread" :
+		USE_RENDER_CORE ? "journal, inline" : "inline");
+	printf("dispatch:     %s%s\n", USE_THREADED_DISPATCH ? "threaded" : "switch",
+		USE_THREADED_DISPATCH && USE_SUPERINSTRUCTIONS ? " + fused pairs" : "");
+	printf("cpu:          %.1f ns/scanline\n", (double)bench_total[BENCH_CPU] / lines);
+	printf("instructions: %.2f M/s (%.2f ns/insn)\n",
+		bench_stats[BENCH_STAT_INSNS] * 1e3 / bench_total[BENCH_CPU],
+		(double)bench_total[BENCH_CPU] / bench_stats[BENCH_STAT_INSNS]);
+	printf("idle skipped: %.0f cycles/frame\n", (double)PCE.IdleCycles / frames);
+#if TILE_CACHE_SIZE
+	printf("tile cache:   %d entries, %.0f hits/frame, %.0f misses/frame\n", TILE_CACHE_SIZE,
+		(double)PCE.TileHits / frames, (double)PCE.TileMisses / frames);
+#endif
+#if SPRITE_CACHE_SIZE
+	printf("sprite cache: %d entries, %.0f hits/frame, %.0f misses/frame\n", SPRITE_CACHE_SIZE,
+		(double)PCE.SpriteHits / frames, (double)PCE.SpriteMisses / frames);
+#endif
+#if ENABLE_PROFILER
+	printf("bank cache:   %d slots, %u banks loaded, %.2f%% of ROM instructions from SRAM\n",
+		(int)PCE.BankSlots, PCE.BankLoads,
+		Profile.rom_insns ? Profile.sram_insns * 100.0 / Profile.rom_insns : 0.0);
+#else
+	printf("bank cache:   %d slots, %u banks loaded\n", (int)PCE.BankSlots, PCE.BankLoads);
+#endif
+	char report[160];
+	pce_memory_report(report, sizeof(report));
+	printf("memory:       %s\n", report);
+#if USE_PSRAM_ROM
+	printf("psram:        %.1f KB/frame read, %.1f KB/frame written\n",
+		psram_reads / 1024.0 / frames, psram_writes / 1024.0 / frames);
+#endif
+	printf("gfx_run:      %.1f ns/scanline\n", (double)bench_total[BENCH_GFX] / lines);
+	printf("psg_update:   %.2f ns/sample\n", (double)bench_total[BENCH_PSG] / samples);
+	printf("state digest: %08X\n", state_digest());
+#if ENABLE_BENCH_PAIRS
+	print_pairs(24);
+#endif
+#if ENABLE_PROFILER
+	if (profile && SaveProfile(profile) < 0) {
+		fprintf(stderr, "Failed to save the profile to %s\n", profile);
+	}
+#else
+	if (profile) {
+		fprintf(stderr, "warning: built without ENABLE_PROFILER, no profile saved\n");
+	}
+#endif
+
+	for (int i = 0; i < BENCH_MAX; i++) {
+		if (!bench_calls[i]) {
+			fprintf(stderr, "warning: no samples for %s\n", bench_names[i]);
+		}
+	}
+
+#if USE_RENDER_CORE
+	if (threaded) {
+		gfx_render_async(false);
+		render_thread_stop = true;
+		pthread_join(render_tid, NULL);
+	}
+#endif
+
+	ShutdownPCE();
+	free(rom);
+#if USE_PSRAM_ROM
+	free(psram);
+#endif
+
+	return 0;
+}
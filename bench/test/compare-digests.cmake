@@ -0,0 +1,45 @@
+# Runs ROM for FRAMES frames through every bench in BENCHES with -d and fails
+# when a frame's state digest differs from the first run's. With OPTIONS,
+# each bench runs once more per option (-i: without the idle loop skip).
+#
+#   cmake -DROM=test.pce -DFRAMES=300 "-DBENCHES=a;b" -P compare-digests.cmake
+#   cmake -DROM=test.pce -DFRAMES=300 -DBENCHES=a -DOPTIONS=-i -P compare-digests.cmake
+#
+set(runs)
+foreach (bench ${BENCHES})
+	list(APPEND runs "${bench}")
+	foreach (option ${OPTIONS})
+		list(APPEND runs "${bench} ${option}")
+	endforeach()
+endforeach()
+
+foreach (run ${runs})
+	separate_arguments(command UNIX_COMMAND "${run}")
+	execute_process(COMMAND ${command} -n ${FRAMES} -w 0 -d ${ROM}
+			OUTPUT_VARIABLE output RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${run} failed (${result})")
+	endif()
+
+	string(REGEX MATCHALL "frame [0-9]+: [0-9A-F]+" digests "${output}")
+	list(LENGTH digests count)
+	if (NOT count EQUAL FRAMES)
+		message(FATAL_ERROR "${run} printed ${count} digests out of ${FRAMES}")
+	endif()
+
+	if (NOT DEFINED reference)
+		set(reference ${run})
+		set(reference_digests "${digests}")
+		continue()
+	endif()
+
+	foreach (i RANGE 1 ${FRAMES})
+		math(EXPR i "${i} - 1")
+		list(GET digests ${i} frame)
+		list(GET reference_digests ${i} expected)
+		if (NOT frame STREQUAL expected)
+			message(FATAL_ERROR "${run} differs from ${reference}\n  ${expected}\n  ${frame}")
+		endif()
+	endforeach()
+	message(STATUS "${run}: ${count} frames match")
+endforeach()
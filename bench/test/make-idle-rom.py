@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+#
+# Writes an 8KB HuCard whose loop looks idle from its registers but leaves
+# the body through a branch to code that writes RAM and jumps back. The idle
+# loop skip must not fast-forward it, the bench tests compare its digests
+# with -i.
+#
+#   top:  LDX #0
+#         BEQ ext
+#   back: BRA top
+#   ext:  INC $21
+#         JMP back
+#
+#   make-idle-rom.py idle.pce
+#
+import sys
+
+code = bytearray([
+	0x78, 0xD4, 0xD8,				# SEI, CSH, CLD
+	0xA9, 0xFF, 0x53, 0x01,			# MPR0 = $FF (I/O)
+	0xA9, 0xF8, 0x53, 0x02,			# MPR1 = $F8 (RAM)
+	0xA2, 0xFF, 0x9A,				# S = $FF
+	0x64, 0x21,						# STZ $21
+])
+top = 0xE000 + len(code)
+code += bytes([0xA2, 0x00])			# top: LDX #0
+code += bytes([0xF0, 0x02])			# BEQ ext
+back = 0xE000 + len(code)
+code += bytes([0x80, (top - (back + 2)) & 0xFF])	# back: BRA top
+code += bytes([0xE6, 0x21])			# ext: INC $21
+code += bytes([0x4C]) + back.to_bytes(2, 'little')	# JMP back
+rti = 0xE000 + len(code)
+code += bytes([0x40])				# RTI
+
+rom = bytearray(0x2000)
+rom[:len(code)] = code
+for vector in (0x1FF6, 0x1FF8, 0x1FFA, 0x1FFC):
+	rom[vector:vector + 2] = rti.to_bytes(2, 'little')
+rom[0x1FFE:0x2000] = (0xE000).to_bytes(2, 'little')
+
+with open(sys.argv[1], 'wb') as f:
+	f.write(rom)
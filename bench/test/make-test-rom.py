@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+#
+# Writes a small HuCard image for the bench tests: it fills VRAM, the
+# palette and the SATB with pseudo-random data, then loops on decimal and
+# binary arithmetic, shifts, block transfers to VRAM, scroll changes and
+# raster splits from the VDC IRQ, and waits for the VBlank in an idle loop.
+#
+#   make-test-rom.py test.pce
+#
+import sys
+
+ZP_SEED, ZP_SEED2, ZP_BCD, ZP_ROT, ZP_INC, ZP_DEC, ZP_FRAME, ZP_SCROLL = range(0x00, 0x08)
+
+code = bytearray()
+labels = {}
+fixups = []		# (offset, label, kind)
+
+
+def emit(*b):
+	code.extend(b)
+
+
+def label(name):
+	labels[name] = 0xE000 + len(code)
+
+
+def abs16(op, name):
+	emit(op)
+	fixups.append((len(code), name, 'abs'))
+	emit(0, 0)
+
+
+def branch(op, name):
+	emit(op)
+	fixups.append((len(code), name, 'rel'))
+	emit(0)
+
+
+def vdc(reg, value):
+	emit(0x03, reg, 0x13, value & 0xFF, 0x23, value >> 8)	# ST0, ST1, ST2
+
+
+# Reset
+label('reset')
+emit(0x78, 0xD4, 0xD8)					# SEI, CSH, CLD
+emit(0xA9, 0xFF, 0x53, 0x01)			# MPR0 = $FF (I/O)
+emit(0xA9, 0xF8, 0x53, 0x02)			# MPR1 = $F8 (RAM)
+emit(0xA2, 0xFF, 0x9A)					# S = $FF
+emit(0xA9, 0x5A, 0x85, ZP_SEED)
+emit(0xA9, 0xC3, 0x85, ZP_SEED2)
+for zp in (ZP_BCD, ZP_ROT, ZP_INC, ZP_DEC, ZP_FRAME, ZP_SCROLL):
+	emit(0x64, zp)						# STZ zp
+
+vdc(0x05, 0x0000)						# CR: display off while filling
+vdc(0x09, 0x0010)						# MWR: 64x32 map
+vdc(0x0A, 0x0202)						# HSR
+vdc(0x0B, 0x041F)						# HDR: 256 pixels
+vdc(0x0C, 0x0F02)						# VPR
+vdc(0x0D, 0x00EF)						# VDW: 240 lines
+vdc(0x0E, 0x0003)						# VCR
+vdc(0x00, 0x0000)						# MAWR = 0
+emit(0x03, 0x02)						# ST0 #2 (VWR)
+emit(0xA0, 0x80)						# 128 x 256 words
+label('fill_vram')
+emit(0xA2, 0x00)
+label('fill_vram_row')
+abs16(0x20, 'rnd')
+emit(0x8D, 0x02, 0x00)					# STA $0002
+abs16(0x20, 'rnd')
+emit(0x8D, 0x03, 0x00)					# STA $0003
+emit(0xCA)
+branch(0xD0, 'fill_vram_row')
+emit(0x88)
+branch(0xD0, 'fill_vram')
+
+emit(0x9C, 0x02, 0x04, 0x9C, 0x03, 0x04)	# VCE address = 0
+emit(0xA0, 0x02)						# 2 x 256 colours
+label('fill_pal')
+emit(0xA2, 0x00)
+label('fill_pal_row')
+abs16(0x20, 'rnd')
+emit(0x8D, 0x04, 0x04)
+abs16(0x20, 'rnd')
+emit(0x29, 0x01, 0x8D, 0x05, 0x04)		# AND #1, STA $0405
+emit(0xCA)
+branch(0xD0, 'fill_pal_row')
+emit(0x88)
+branch(0xD0, 'fill_pal')
+
+# PSG channel 0: waveform, frequency, full volume
+emit(0x9C, 0x00, 0x08)					# channel 0
+emit(0xA9, 0xFF, 0x8D, 0x01, 0x08)		# main volume
+emit(0x9C, 0x04, 0x08)					# off, to write the waveform
+emit(0xA2, 0x20)
+label('fill_wave')
+abs16(0x20, 'rnd')
+emit(0x29, 0x1F, 0x8D, 0x06, 0x08)
+emit(0xCA)
+branch(0xD0, 'fill_wave')
+emit(0xA9, 0x80, 0x8D, 0x02, 0x08, 0x9C, 0x03, 0x08)
+emit(0xA9, 0x9F, 0x8D, 0x04, 0x08, 0xA9, 0xFF, 0x8D, 0x05, 0x08)
+
+vdc(0x13, 0x7F00)						# SATB at $7F00
+vdc(0x0F, 0x0010)						# DCR: auto SATB DMA
+vdc(0x06, 0x0040 + 96)					# RCR: split at line 96
+vdc(0x05, 0x00CC)						# CR: BG, sprites, VBlank and raster IRQs
+emit(0xA9, 0x05, 0x8D, 0x02, 0x14)		# IRQ mask: only IRQ1
+emit(0x58)								# CLI
+
+label('main')
+# Decimal arithmetic
+emit(0xF8, 0x18, 0xA5, ZP_BCD, 0x69, 0x19, 0x85, ZP_BCD, 0xD8)
+# Shifts and flags
+emit(0x66, ZP_ROT)						# ROR zp
+emit(0x24, ZP_ROT)						# BIT zp
+branch(0x30, 'negative')
+emit(0xE6, ZP_INC)
+label('negative')
+emit(0xC6, ZP_DEC)
+emit(0xA5, ZP_INC, 0x38, 0xE5, ZP_DEC, 0x45, ZP_SEED, 0x0A, 0x2A, 0x4A, 0x85, ZP_ROT)
+# Block transfers: RAM to RAM, then RAM to VRAM at a random address
+emit(0x73, 0x00, 0x20, 0x00, 0x21, 0x40, 0x00)	# TII $2000, $2100, 64
+emit(0x03, 0x00)
+abs16(0x20, 'rnd')
+emit(0x8D, 0x02, 0x00)
+abs16(0x20, 'rnd')
+emit(0x29, 0x3F, 0x8D, 0x03, 0x00)		# below the SATB
+emit(0x03, 0x02)
+emit(0xE3, 0x00, 0x21, 0x02, 0x00, 0x20, 0x00)	# TIA $2100, $0002, 32
+# PSG frequency
+emit(0xA5, ZP_FRAME, 0x8D, 0x02, 0x08)
+# Wait for the VBlank
+emit(0xA5, ZP_FRAME)
+label('wait')
+emit(0xC5, ZP_FRAME)
+branch(0xF0, 'wait')
+abs16(0x4C, 'main')
+
+# A = next pseudo-random byte
+label('rnd')
+emit(0xA5, ZP_SEED, 0x0A, 0x0A, 0x18, 0x65, ZP_SEED, 0x18, 0x69, 0x3B, 0x85, ZP_SEED)
+emit(0x46, ZP_SEED2)					# LSR zp
+branch(0x90, 'rnd_nc')
+emit(0xA9, 0xB8, 0x45, ZP_SEED2, 0x85, ZP_SEED2)
+label('rnd_nc')
+emit(0xA5, ZP_SEED, 0x45, ZP_SEED2, 0x60)
+
+# VDC IRQ: raster split moves BXR, VBlank counts the frame and scrolls
+label('irq1')
+emit(0x48)								# PHA
+emit(0xAD, 0x00, 0x00)					# LDA $0000, acknowledge
+emit(0x29, 0x04)
+branch(0xF0, 'vblank')
+emit(0x03, 0x07, 0xA5, ZP_SCROLL, 0x0A, 0x8D, 0x02, 0x00, 0x23, 0x00)
+branch(0x80, 'irq_done')
+label('vblank')
+emit(0xE6, ZP_FRAME, 0xE6, ZP_SCROLL)
+emit(0x03, 0x07, 0xA5, ZP_SCROLL, 0x8D, 0x02, 0x00, 0x23, 0x00)
+emit(0x03, 0x08, 0xA5, ZP_FRAME, 0x8D, 0x02, 0x00, 0x23, 0x00)
+label('irq_done')
+emit(0x68, 0x40)						# PLA, RTI
+
+label('rti')
+emit(0x40)
+
+for offset, name, kind in fixups:
+	target = labels[name]
+	if kind == 'abs':
+		code[offset:offset + 2] = target.to_bytes(2, 'little')
+	else:
+		rel = target - (0xE000 + offset + 1)
+		assert -128 <= rel < 128, name
+		code[offset] = rel & 0xFF
+
+rom = bytearray(0x2000)
+rom[:len(code)] = code
+for vector, name in ((0x1FF6, 'rti'), (0x1FF8, 'irq1'), (0x1FFA, 'rti'), (0x1FFC, 'rti'), (0x1FFE, 'reset')):
+	rom[vector:vector + 2] = labels[name].to_bytes(2, 'little')
+
+with open(sys.argv[1], 'wb') as f:
+	f.write(rom)
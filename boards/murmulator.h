@@ -22,6 +22,12 @@
 #define NES_GPIO_DATA 16
 #define NES_GPIO_LAT 15
 
+// PSRAM (PSRAM=ON builds)
+#define PSRAM_PIN_CS 18
+#define PSRAM_PIN_SCK 19
+#define PSRAM_PIN_MOSI 20
+#define PSRAM_PIN_MISO 21
+
 // VGA 8 pins starts from pin:
 #define VGA_BASE_PIN 6
 
@@ -53,6 +53,10 @@ void graphics_set_mode(enum graphics_mode_t mode);
 
 void graphics_set_buffer(uint8_t* buffer, uint16_t width, uint16_t height);
 
+// Ask source for each line of the graphics mode just before it's shown
+// instead of reading the buffer (HDMI and VGA only, NULL to go back)
+void graphics_set_line_source(uint8_t* (*source)(int y));
+
 void graphics_set_offset(int x, int y);
 
 void graphics_set_palette(uint8_t i, uint32_t color);
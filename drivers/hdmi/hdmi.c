@@ -32,6 +32,8 @@ static int graphics_buffer_width = 0;
 static int graphics_buffer_height = 0;
 static int graphics_buffer_shift_x = 0;
 static int graphics_buffer_shift_y = 0;
+//источник строк вместо буфера (graphics_set_line_source)
+static uint8_t* (*graphics_line_source)(int y) = NULL;
 
 //текстовый буфер
 uint8_t* text_buffer = NULL;
@@ -184,7 +186,7 @@ static void __scratch_y("hdmi_driver") dma_handler_HDMI() {
 
     uint8_t* activ_buf = (uint8_t *) dma_lines[inx_buf_dma & 1];
 
-    if (graphics_buffer && line < 480) {
+    if ((graphics_buffer || graphics_line_source) && line < 480) {
         //область изображения
         uint8_t* input_buffer = &graphics_buffer[(line / 2) * graphics_buffer_width];
         uint8_t* output_buffer = activ_buf + 72; //для выравнивания синхры;
@@ -204,7 +206,9 @@ static void __scratch_y("hdmi_driver") dma_handler_HDMI() {
                 output_buffer += graphics_buffer_shift_x;
 
                 //рисуем сам видеобуфер+пространство справа
-                input_buffer = &graphics_buffer[(y - graphics_buffer_shift_y) * (16+320+16)];
+                input_buffer = graphics_line_source
+                                   ? graphics_line_source(y - graphics_buffer_shift_y)
+                                   : &graphics_buffer[(y - graphics_buffer_shift_y) * (16+320+16)];
 
                 const uint8_t* input_buffer_end = input_buffer + graphics_buffer_width;
 
@@ -550,6 +554,10 @@ void graphics_set_buffer(uint8_t* buffer, uint16_t width, uint16_t height) {
     graphics_buffer_height = height;
 };
 
+void graphics_set_line_source(uint8_t* (*source)(int y)) {
+    graphics_line_source = source;
+};
+
 
 //выделение и настройка общих ресурсов - 4 DMA канала, PIO программ и 2 SM
 void graphics_init() {
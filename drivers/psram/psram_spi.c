@@ -5,8 +5,8 @@ extern bool PSRAM_AVAILABLE;
 
 void init_psram() {
     psram_spi = psram_spi_init_clkdiv(pio0, -1, 2.0, true);
- //   psram_write32(&psram_spi, 0x313373, 0xDEADBEEF);
- //   PSRAM_AVAILABLE = 0xDEADBEEF == psram_read32(&psram_spi, 0x313373);
+    psram_write32(&psram_spi, 0x313373, 0xDEADBEEF);
+    PSRAM_AVAILABLE = 0xDEADBEEF == psram_read32(&psram_spi, 0x313373);
 }
 
 void psram_memset(uint32_t addr32, uint32_t val, uint32_t size) {
@@ -57,6 +57,27 @@ uint16_t read16psram(uint32_t addr32) {
     return psram_read16(&psram_spi, addr32);
 }
 
+// psram_read/psram_write take at most 31/27 bytes (8-bit bit counts)
+void readpsram(uint8_t* dst, uint32_t addr32, uint32_t size) {
+    while (size) {
+        uint32_t count = size < 28 ? size : 28;
+        psram_read(&psram_spi, addr32, dst, count);
+        addr32 += count;
+        dst += count;
+        size -= count;
+    }
+}
+
+void writepsram(uint32_t addr32, const uint8_t* src, uint32_t size) {
+    while (size) {
+        uint32_t count = size < 24 ? size : 24;
+        psram_write(&psram_spi, addr32, src, count);
+        addr32 += count;
+        src += count;
+        size -= count;
+    }
+}
+
 #include <stdio.h>
 
 #if defined(PSRAM_ASYNC) && defined(PSRAM_ASYNC_SYNCHRONIZE)
@@ -618,6 +618,8 @@ void write8psram(uint32_t addr32, uint8_t v);
 void write16psram(uint32_t addr32, uint16_t v);
 uint8_t read8psram(uint32_t addr32);
 uint16_t read16psram(uint32_t addr32);
+void readpsram(uint8_t* dst, uint32_t addr32, uint32_t size);
+void writepsram(uint32_t addr32, const uint8_t* src, uint32_t size);
 
 #ifdef __cplusplus
 }
@@ -48,6 +48,8 @@ static uint graphics_buffer_width = 0;
 static uint graphics_buffer_height = 0;
 static int graphics_buffer_shift_x = 0;
 static int graphics_buffer_shift_y = 0;
+//источник строк вместо буфера (graphics_set_line_source)
+static uint8_t* (*graphics_line_source)(int y) = NULL;
 
 static bool is_flash_line = false;
 static bool is_flash_frame = false;
@@ -102,7 +104,7 @@ void __time_critical_func() dma_handler_VGA() {
         return;
     }
 
-    if (!input_buffer) {
+    if (!input_buffer && !graphics_line_source) {
         dma_channel_set_read_addr(dma_chan_ctrl, &lines_pattern[0], false);
         return;
     } //если нет видеобуфера - рисуем пустую строку
@@ -307,7 +309,9 @@ void __time_critical_func() dma_handler_VGA() {
         }
         // Это только для sega
         case GRAPHICSMODE_DEFAULT:
-            input_buffer_8bit = (width == 256 ? 0 : 16) + (input_buffer + y * (16+320+16));
+            input_buffer_8bit = (width == 256 ? 0 : 16) + (graphics_line_source
+                                                               ? graphics_line_source(y)
+                                                               : input_buffer + y * (16+320+16));
             for (int i = width; i--;) {
                 *output_buffer_16bit++ = current_palette[*input_buffer_8bit++];
             }
@@ -454,6 +458,10 @@ void graphics_set_buffer(uint8_t* buffer, const uint16_t width, const uint16_t h
     graphics_buffer_height = height;
 }
 
+void graphics_set_line_source(uint8_t* (*source)(int y)) {
+    graphics_line_source = source;
+}
+
 
 void graphics_set_offset(const int x, const int y) {
     graphics_buffer_shift_x = x;
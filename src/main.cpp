@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <cstring>
+#include <hardware/dma.h>
 #include <hardware/flash.h>
 #include <hardware/vreg.h>
 #include <hardware/watchdog.h>
@@ -8,6 +9,7 @@
 
 extern "C" {
 #include <pce-go/pce.h>
+#include <pce-go/gfx.h>
 #include <pce-go/psg.h>
 }
 
@@ -17,23 +19,110 @@ extern "C" {
 #include "nespad.h"
 #include "ff.h"
 #include "ps2kbd_mrmltr.h"
+#ifdef PSRAM
+#include "psram_spi.h"
+#endif
 
 #define HOME_DIR "\\PCE"
 extern char __flash_binary_end;
 #define FLASH_TARGET_OFFSET (((((uintptr_t)&__flash_binary_end - XIP_BASE) / FLASH_SECTOR_SIZE) + 4) * FLASH_SECTOR_SIZE)
 static const uintptr_t rom = XIP_BASE + FLASH_TARGET_OFFSET;
 
+// Describes the ROM in flash, in the sector before it. Written once the ROM
+// is programmed, so a matching header means the copy is complete.
+#define ROM_HEADER_OFFSET (FLASH_TARGET_OFFSET - FLASH_SECTOR_SIZE)
+#define ROM_HEADER_MAGIC 0x324D5250 // "PRM2"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc;       // Of the file, before decoding
+    uint16_t fdate;
+    uint16_t ftime;
+    uint32_t flags;
+    char path[256];
+} rom_header_t;
+
+#define ROM_HEADER_US_DECODED 0x0001 // Bits of the US encoded file reversed
+
+static_assert(sizeof(rom_header_t) <= FLASH_PAGE_SIZE * 2, "ROM header must fit in two flash pages");
+
+// CRC-32 (IEEE) of the file, from the DMA sniffer while the chunks are read:
+// each chunk is copied by a DMA channel to a dummy word, the sniffer
+// accumulates the bytes it reads.
+static int crc_dma_chan = -1;
+
+static void crc32_start() {
+    static uint32_t dummy;
+
+    crc_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(crc_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+    dma_channel_configure(crc_dma_chan, &c, &dummy, nullptr, 0, false);
+
+    // Bit reversed CRC-32, reversed and inverted when read like zlib's
+    dma_sniffer_enable(crc_dma_chan, 0x1, true);
+    dma_sniffer_set_output_reverse_enabled(true);
+    dma_sniffer_set_output_invert_enabled(true);
+    dma_sniffer_set_data_accumulator(0xFFFFFFFF);
+}
+
+static void crc32_update(const uint8_t *data, uint32_t len) {
+    dma_channel_transfer_from_buffer_now(crc_dma_chan, data, len);
+    dma_channel_wait_for_finish_blocking(crc_dma_chan);
+}
+
+static uint32_t crc32_end() {
+    const uint32_t crc = dma_sniffer_get_data_accumulator();
+    dma_sniffer_disable();
+    dma_channel_unclaim(crc_dma_chan);
+    return crc;
+}
+
+#ifdef PSRAM
+#if !defined(PSRAM_PIN_CS) || !defined(PSRAM_PIN_SCK) || !defined(PSRAM_PIN_MOSI) || !defined(PSRAM_PIN_MISO)
+#error "PSRAM needs the PSRAM_PIN_* defines of the board"
+#endif
+#define PSRAM_SIZE (8 << 20)
+// ROMs are copied to PSRAM instead of flash when the chip answers
+bool PSRAM_AVAILABLE = false;
+
+extern "C" void osd_psram_read(uint32_t addr, void *dst, size_t len) {
+    readpsram((uint8_t *) dst, addr, len);
+}
+
+extern "C" void osd_psram_write(uint32_t addr, const void *src, size_t len) {
+    writepsram(addr, (const uint8_t *) src, len);
+}
+#endif
+
 #define AUDIO_SAMPLE_RATE 22050
 #define AUDIO_BUFFER_LENGTH (AUDIO_SAMPLE_RATE / 60 + 1)
 
 char __uninitialized_ram(filename[256]);
 static uint32_t __uninitialized_ram(rom_size);
+static uint32_t __uninitialized_ram(rom_crc);
 
 static FATFS fs;
 bool reboot = false;
 semaphore vga_start_semaphore;
 
+#if USE_BEAM_RENDER
+// No framebuffer, the display asks gfx_beam_line for the game lines. The
+// text mode gets its own buffer, the file list and the load chunks go to
+// the card arena, which only holds a card once the ROM is loaded.
+alignas(4) static uint8_t TEXT_BUFFER[TEXTMODE_COLS * TEXTMODE_ROWS * 2];
+#define GAME_BUFFER ((uint8_t *) nullptr)
+#define FILE_BUFFER CardArena
+#else
 alignas(4) uint8_t SCREEN[XBUF_HEIGHT][XBUF_WIDTH];
+#define TEXT_BUFFER (&SCREEN[0][0])
+#define GAME_BUFFER (&SCREEN[0][0])
+#define FILE_BUFFER (&SCREEN[0][0] + TEXTMODE_COLS * TEXTMODE_ROWS * 2)
+#endif
 alignas(4) int audio_buffer[AUDIO_BUFFER_LENGTH];
 
 struct input_bits_t {
@@ -192,7 +281,10 @@ typedef struct __attribute__((__packed__)) {
 } file_item_t;
 
 constexpr int max_files = 600;
-file_item_t *fileItems = (file_item_t *) (&SCREEN[0][0] + TEXTMODE_COLS * TEXTMODE_ROWS * 2);
+file_item_t *fileItems = (file_item_t *) FILE_BUFFER;
+#if USE_BEAM_RENDER
+static_assert(sizeof(file_item_t) * max_files <= CARD_ARENA_SIZE, "file list must fit in the card arena");
+#endif
 
 int compareFileItems(const void *a, const void *b) {
     const auto *itemA = (file_item_t *) a;
@@ -227,6 +319,55 @@ bool isExecutable(const char pathname[255], const char *extensions) {
     return false;
 }
 
+// ROMs are streamed in chunks of this size, multi-block SD reads and 64KB flash block erases
+#define LOAD_CHUNK_SIZE (64 << 10)
+
+// US encoded ROMs are decoded before they're written, LoadCard can't write
+// to flash. Detected on the first bank, after the optional 512-byte header,
+// or from the game database once the CRC is known.
+static bool is_us_encoded(const uint8_t *buffer, uint32_t len, uint32_t fsize) {
+    const uint32_t skip = fsize & 0x1FFF;
+    return skip + 0x1FFF < len && IS_US_ENCODED(buffer[skip + 0x1FFF]);
+}
+
+static void decode_chunk(uint8_t *buffer, uint32_t len, uint32_t offset, uint32_t fsize) {
+    for (uint32_t i = offset ? 0 : fsize & 0x1FFF; i < len; i++)
+        buffer[i] = US_DECODE[buffer[i]];
+}
+
+static bool needs_decode(uint32_t crc, bool us_encoded) {
+    const game_info_t *game = FindGame(crc);
+    return !us_encoded && game && (game->Flags & US_ENCODED);
+}
+
+// Erases and programs each run of 4KB sectors whose contents changed (the
+// boot ROM uses 64KB block erases where aligned). Core 1 is only held while
+// flash is written.
+static void program_chunk(uint32_t flash_offset, const uint8_t *buffer, uint32_t chunk_size) {
+    uint32_t run_start = 0;
+    for (uint32_t pos = 0; pos <= chunk_size; pos += FLASH_SECTOR_SIZE) {
+        if (pos < chunk_size && memcmp(buffer + pos, (const void *) (XIP_BASE + flash_offset + pos), FLASH_SECTOR_SIZE) != 0)
+            continue;
+        if (pos > run_start) {
+            multicore_lockout_start_blocking();
+            const uint32_t ints = save_and_disable_interrupts();
+            flash_range_erase(flash_offset + run_start, pos - run_start);
+            flash_range_program(flash_offset + run_start, buffer + run_start, pos - run_start);
+            restore_interrupts(ints);
+            multicore_lockout_end_blocking();
+        }
+        run_start = pos + FLASH_SECTOR_SIZE;
+    }
+}
+
+static void draw_load_progress(int x, int y, uint32_t done, uint32_t total, uint64_t start) {
+    char text[42];
+    const uint32_t elapsed = time_us_64() - start;
+    snprintf(text, sizeof(text), "Loading... %5lu/%lu KB %5.2f MB/s", done >> 10, total >> 10,
+             elapsed ? done / (elapsed * 1.048576f) : 0.0f);
+    draw_text(text, x, y, 10, 1);
+}
+
 bool filebrowser_loadfile(const char pathname[256]) {
     UINT bytes_read = 0;
     FIL file;
@@ -239,45 +380,152 @@ bool filebrowser_loadfile(const char pathname[256]) {
     FILINFO fileinfo;
     f_stat(pathname, &fileinfo);
     rom_size = fileinfo.fsize;
+    rom_crc = 0;
+
+    // The file list isn't needed anymore, the chunks are read there
+#if USE_BEAM_RENDER
+    static_assert(LOAD_CHUNK_SIZE <= CARD_ARENA_SIZE, "load chunk must fit in the card arena");
+#else
+    static_assert(TEXTMODE_COLS * TEXTMODE_ROWS * 2 + LOAD_CHUNK_SIZE <= sizeof(SCREEN), "load chunk must fit in SCREEN");
+#endif
+    const auto buffer = (uint8_t *) fileItems;
+    const uint64_t start = time_us_64();
+
+#ifdef PSRAM
+    // No flash erase: the ROM (and the card RAM after it) go to PSRAM
+    if (PSRAM_AVAILABLE) {
+        if (PSRAM_SIZE - PSRAM_CARD_RAM_SIZE < fileinfo.fsize) {
+            draw_text("ERROR: ROM too large! Canceled!!", window_x + 1, window_y + 2, 13, 1);
+            sleep_ms(5000);
+            return false;
+        }
+
+        if (FR_OK != f_open(&file, pathname, FA_READ))
+            return false;
+
+        uint32_t psram_offset = 0;
+        bool us_encoded = false;
+        crc32_start();
+        do {
+            draw_load_progress(window_x + 1, window_y + 2, psram_offset, fileinfo.fsize, start);
+            f_read(&file, buffer, LOAD_CHUNK_SIZE, &bytes_read);
+            if (bytes_read) {
+                crc32_update(buffer, bytes_read);
+                if (psram_offset == 0)
+                    us_encoded = is_us_encoded(buffer, bytes_read, fileinfo.fsize);
+                if (us_encoded)
+                    decode_chunk(buffer, bytes_read, psram_offset, fileinfo.fsize);
+                writepsram(psram_offset, buffer, bytes_read);
+                gpio_put(PICO_DEFAULT_LED_PIN, psram_offset >> 16 & 1);
+                psram_offset += bytes_read;
+            }
+        } while (bytes_read != 0);
+        f_close(&file);
+        rom_crc = crc32_end();
+
+        // Encoded, but the reset vector didn't tell
+        if (needs_decode(rom_crc, us_encoded)) {
+            for (uint32_t offset = 0; offset < fileinfo.fsize; offset += LOAD_CHUNK_SIZE) {
+                const uint32_t len = MIN((uint32_t) LOAD_CHUNK_SIZE, fileinfo.fsize - offset);
+                readpsram(buffer, offset, len);
+                decode_chunk(buffer, len, offset, fileinfo.fsize);
+                writepsram(offset, buffer, len);
+            }
+        }
+        gpio_put(PICO_DEFAULT_LED_PIN, true);
+        draw_load_progress(window_x + 1, window_y + 2, psram_offset, fileinfo.fsize, start);
+        sleep_ms(500);
+
+        strcpy(filename, fileinfo.fname);
+        return true;
+    }
+#endif
     if (16384 - 64 << 10 < fileinfo.fsize) {
         draw_text("ERROR: ROM too large! Canceled!!", window_x + 1, window_y + 2, 13, 1);
         sleep_ms(5000);
         return false;
     }
 
-    draw_text("Loading...", window_x + 1, window_y + 2, 10, 1);
-    sleep_ms(500);
-
-    multicore_lockout_start_blocking();
-    auto flash_target_offset = FLASH_TARGET_OFFSET;
-    const uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(flash_target_offset, fileinfo.fsize);
-    restore_interrupts(ints);
-
-    if (FR_OK == f_open(&file, pathname, FA_READ)) {
-        uint8_t buffer[FLASH_PAGE_SIZE];
-
-        do {
-            f_read(&file, &buffer, FLASH_PAGE_SIZE, &bytes_read);
+    strcpy(filename, fileinfo.fname);
 
-            if (bytes_read) {
-                const uint32_t ints = save_and_disable_interrupts();
-                flash_range_program(flash_target_offset, buffer, FLASH_PAGE_SIZE);
-                restore_interrupts(ints);
+    // Same file as last time: nothing to write. The header is only written
+    // once the whole image is, its CRC is the file's.
+    const auto header = (const rom_header_t *) (XIP_BASE + ROM_HEADER_OFFSET);
+    if (header->magic == ROM_HEADER_MAGIC && header->size == fileinfo.fsize &&
+        header->fdate == fileinfo.fdate && header->ftime == fileinfo.ftime &&
+        strncmp(header->path, pathname, sizeof(header->path)) == 0) {
+        rom_crc = header->crc;
+        return true;
+    }
 
-                gpio_put(PICO_DEFAULT_LED_PIN, flash_target_offset >> 13 & 1);
+    if (FR_OK != f_open(&file, pathname, FA_READ))
+        return false;
 
-                flash_target_offset += FLASH_PAGE_SIZE;
-            }
-        } while (bytes_read != 0);
+    // Invalidate the header first, an interrupted load must not match
+    multicore_lockout_start_blocking();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(ROM_HEADER_OFFSET, FLASH_SECTOR_SIZE);
+    restore_interrupts(ints);
+    multicore_lockout_end_blocking();
 
-        gpio_put(PICO_DEFAULT_LED_PIN, true);
-    }
+    // Core 1 keeps drawing the progress while the SD card is read
+    auto flash_target_offset = FLASH_TARGET_OFFSET;
+    bool us_encoded = false;
+    crc32_start();
+    do {
+        draw_load_progress(window_x + 1, window_y + 2, flash_target_offset - FLASH_TARGET_OFFSET, fileinfo.fsize, start);
+        f_read(&file, buffer, LOAD_CHUNK_SIZE, &bytes_read);
+
+        if (bytes_read) {
+            const uint32_t chunk_size = (bytes_read + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+            crc32_update(buffer, bytes_read);
+            if (flash_target_offset == FLASH_TARGET_OFFSET)
+                us_encoded = is_us_encoded(buffer, bytes_read, fileinfo.fsize);
+            if (us_encoded)
+                decode_chunk(buffer, bytes_read, flash_target_offset - FLASH_TARGET_OFFSET, fileinfo.fsize);
+            memset(buffer + bytes_read, 0xFF, chunk_size - bytes_read);
+
+            program_chunk(flash_target_offset, buffer, chunk_size);
+
+            gpio_put(PICO_DEFAULT_LED_PIN, flash_target_offset >> 16 & 1);
+
+            flash_target_offset += chunk_size;
+        }
+    } while (bytes_read != 0);
     f_close(&file);
+    rom_crc = crc32_end();
+
+    // Encoded, but the reset vector didn't tell: decode the flash copy
+    if (needs_decode(rom_crc, us_encoded)) {
+        us_encoded = true;
+        for (uint32_t offset = 0; offset < fileinfo.fsize; offset += LOAD_CHUNK_SIZE) {
+            const uint32_t len = MIN((uint32_t) LOAD_CHUNK_SIZE, fileinfo.fsize - offset);
+            const uint32_t chunk_size = (len + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+            memcpy(buffer, (const void *) (rom + offset), chunk_size);
+            decode_chunk(buffer, len, offset, fileinfo.fsize);
+            program_chunk(FLASH_TARGET_OFFSET + offset, buffer, chunk_size);
+        }
+    }
+    draw_load_progress(window_x + 1, window_y + 2, fileinfo.fsize, fileinfo.fsize, start);
+
+    memset(buffer, 0xFF, FLASH_PAGE_SIZE * 2);
+    auto new_header = (rom_header_t *) buffer;
+    new_header->magic = ROM_HEADER_MAGIC;
+    new_header->size = fileinfo.fsize;
+    new_header->crc = rom_crc;
+    new_header->fdate = fileinfo.fdate;
+    new_header->ftime = fileinfo.ftime;
+    new_header->flags = us_encoded ? ROM_HEADER_US_DECODED : 0;
+    strncpy(new_header->path, pathname, sizeof(new_header->path));
+
+    multicore_lockout_start_blocking();
+    ints = save_and_disable_interrupts();
+    flash_range_program(ROM_HEADER_OFFSET, buffer, FLASH_PAGE_SIZE * 2);
+    restore_interrupts(ints);
     multicore_lockout_end_blocking();
-    // restore_interrupts(ints);
 
-    strcpy(filename, fileinfo.fname);
+    gpio_put(PICO_DEFAULT_LED_PIN, true);
+    sleep_ms(500);
 
     return true;
 }
@@ -514,8 +762,7 @@ bool save() {
     } else {
         sprintf(pathname, "%s\\%s.save", HOME_DIR, filename);
     }
-    SaveState(pathname);
-    return true;
+    return SaveState(pathname) > -1;
 }
 
 bool load() {
@@ -527,6 +774,16 @@ bool load() {
     }
     return LoadState(pathname) > -1;
 }
+
+#if ENABLE_PROFILER
+bool save_profile() {
+    char pathname[255];
+    sprintf(pathname, "%s\\%s.prof", HOME_DIR, filename);
+    SaveProfile(pathname);
+    ResetProfile();
+    return true;
+}
+#endif
 #if SOFTTV
 typedef struct tv_out_mode_t {
     // double color_freq;
@@ -560,6 +817,9 @@ const MenuItem menu_items[] = {
         //{ "Player 2: %s",        ARRAY, &player_2_input, 2, { "Keyboard ", "Gamepad 1", "Gamepad 2" }},
         { "Save state: %i", INT, &save_slot, &save, 5 },
         { "Load state: %i", INT, &save_slot, &load, 5 },
+#if ENABLE_PROFILER
+        { "Save profile", SAVE, nullptr, &save_profile },
+#endif
         {},
 #if SOFTTV
         { "TV system %s", ARRAY, &tv_out_mode.tv_system, nullptr, 1, { "PAL ", "NTSC" } },
@@ -687,12 +947,18 @@ void __time_critical_func(render_core)() {
 
     graphics_init();
 
-    const auto buffer = (uint8_t *) SCREEN;
-    graphics_set_buffer(buffer, 256, 240);
-    graphics_set_textbuffer(buffer);
+    graphics_set_buffer(GAME_BUFFER, 256, 240);
+    graphics_set_textbuffer(TEXT_BUFFER);
     graphics_set_bgcolor(0x000000);
 
     graphics_set_offset(32,0);
+#if USE_BEAM_RENDER
+#if !defined(HDMI) && !defined(VGA)
+#error "USE_BEAM_RENDER needs the HDMI or VGA driver"
+#endif
+    // The game lines are drawn by the display IRQ, on this core
+    graphics_set_line_source(gfx_beam_line);
+#endif
 
     for (int i = 0; i < 256; i++) {
         graphics_set_palette(i, RGB888(
@@ -706,6 +972,11 @@ void __time_critical_func(render_core)() {
     graphics_set_flashmode(true, true);
     sem_acquire_blocking(&vga_start_semaphore);
 
+#if USE_RENDER_CORE
+    // Draw the lines core 0 queues from now on
+    gfx_render_async(true);
+#endif
+
     // 60 FPS loop
 #define frame_tick (16666)
     uint64_t tick = time_us_64();
@@ -725,6 +996,10 @@ void __time_critical_func(render_core)() {
 
         tick = time_us_64();
 
+#if USE_RENDER_CORE
+        gfx_render_journal();
+#endif
+
         // tuh_task();
         // hid_app_task();
         tight_loop_contents();
@@ -753,17 +1028,28 @@ int main() {
         gpio_put(PICO_DEFAULT_LED_PIN, false);
     }
 
+#ifdef PSRAM
+    init_psram();
+#endif
+
     if (FR_OK != f_mount(&fs, "SD", 1)) {
         draw_text("SD Card not inserted or SD Card error!", 0, 0, 12, 0);
         while (true);
     }
     f_mkdir(HOME_DIR);
     load_config();
+    LoadGameDB(HOME_DIR "\\pce-games.txt");
 
     while (true) {
         graphics_set_mode(TEXTMODE_DEFAULT);
         filebrowser(HOME_DIR, "pce");
-        InitPCE(AUDIO_SAMPLE_RATE, true, (uint8_t *) rom, rom_size);
+        // filebrowser_loadfile decoded the US encoded images (ROM_HEADER_US_DECODED)
+#ifdef PSRAM
+        // A NULL ROM is read from PSRAM by the core
+        InitPCE(AUDIO_SAMPLE_RATE, true, PSRAM_AVAILABLE ? nullptr : (uint8_t *) rom, rom_size, rom_crc, true);
+#else
+        InitPCE(AUDIO_SAMPLE_RATE, true, (uint8_t *) rom, rom_size, rom_crc, true);
+#endif
         graphics_set_mode(GRAPHICSMODE_DEFAULT);
 
         frame = 0;
@@ -780,12 +1066,16 @@ int main() {
             PCE.Joypad.regs[0] = buttons;
 
             if ((gamepad1_bits.start && gamepad1_bits.select) || (keyboard_bits.start && keyboard_bits.select)) {
+#if USE_RENDER_CORE
+                // The menu draws in SCREEN too
+                gfx_render_sync();
+#endif
                 menu();
             }
 
             pce_run();
 
-            graphics_set_buffer((uint8_t*)SCREEN, PCE.VDC.screen_width == 256 ? 256 : 320, PCE.VDC.screen_height);
+            graphics_set_buffer(GAME_BUFFER, PCE.VDC.screen_width == 256 ? 256 : 320, PCE.VDC.screen_height);
             graphics_set_offset(PCE.VDC.screen_width == 256 ? 32 : 0,0);
 
             psg_update((int16_t *) audio_buffer, AUDIO_BUFFER_LENGTH, 0xff);
@@ -9,3 +9,125 @@
 #define ENABLE_IO_TRACING      0
 
 #define USE_MEM_MACROS         0
+
+// Dispatch opcodes through a table of label addresses (GCC computed goto)
+// instead of the switch statement. The switch is kept as the reference.
+#ifndef USE_THREADED_DISPATCH
+#define USE_THREADED_DISPATCH  1
+#endif
+
+// Keep the last result instead of updating N and Z in P on every load/ALU
+// opcode, P is rebuilt only when it's read as a whole
+#ifndef USE_LAZY_FLAGS
+#define USE_LAZY_FLAGS         1
+#endif
+
+// Run the hot opcode pairs listed in h6280_fusetable.h as one handler
+// (superinstructions). Only with USE_THREADED_DISPATCH.
+#ifndef USE_SUPERINSTRUCTIONS
+#define USE_SUPERINSTRUCTIONS  0
+#endif
+
+// Copy the hottest ROM banks from flash to SRAM, number of 8KB slots
+// (0 disables). RP2350 builds get more, see CMakeLists.txt. That's the
+// slots left with the largest card RAM allocated, cards without it get
+// the rest of CARD_ARENA_SIZE as more slots.
+#ifndef SRAM_BANK_SLOTS
+#if USE_BEAM_RENDER
+#define SRAM_BANK_SLOTS        6	// 4 more in the SRAM SCREEN took
+#else
+#define SRAM_BANK_SLOTS        2
+#endif
+#endif
+
+// Keep the ROM and the card RAM in PSRAM, read and written through
+// osd_psram_read/osd_psram_write. PSRAM banks are copied to a bank cache
+// slot when they're mapped, so SRAM_BANK_SLOTS must cover the 8 pages.
+#ifndef USE_PSRAM_ROM
+#define USE_PSRAM_ROM          0
+#endif
+
+// Background tiles decoded to 4 bits per pixel, number of 32-byte entries
+// (a power of two, 0 disables). A screen can show over 1000 different tiles,
+// a smaller direct-mapped cache thrashes on those, so only RP2350 builds
+// have the SRAM for it (see CMakeLists.txt).
+#ifndef TILE_CACHE_SIZE
+#define TILE_CACHE_SIZE        0
+#endif
+
+// Sprite patterns decoded to 4 bits per pixel, number of 16x16 patterns of
+// 324 bytes (a power of two, 0 disables). RP2350 only, like the tile cache.
+#ifndef SPRITE_CACHE_SIZE
+#define SPRITE_CACHE_SIZE      0
+#endif
+
+// Sprite cells of 16 pixels shown on a line, like the VDC (16), further
+// sprites are dropped and raise the overflow IRQ. 0 shows all of them,
+// without the flicker some games use when they run out.
+#ifndef SPRITE_LINE_LIMIT
+#define SPRITE_LINE_LIMIT      16
+#endif
+
+// Queue the lines to render for another core (gfx_render_journal), which
+// then draws them while core 0 runs the CPU. Core 0 only waits for it when
+// it's about to change VRAM, the palette or the sprites, so the picture is
+// the same as when rendering inline.
+#ifndef USE_RENDER_CORE
+#define USE_RENDER_CORE        0
+#endif
+
+// Don't draw the lines as the CPU passes them, keep their context and let
+// the display driver draw each one just before it's shown (gfx_beam_line).
+// Core 1 then draws from the display IRQ instead of USE_RENDER_CORE. The
+// decoded tile and sprite caches are filled by the renderer and dropped by
+// VRAM writes, which would race across the cores here.
+#ifndef USE_BEAM_RENDER
+#define USE_BEAM_RENDER        0
+#endif
+#if USE_BEAM_RENDER && (USE_RENDER_CORE || TILE_CACHE_SIZE || SPRITE_CACHE_SIZE)
+#error "USE_BEAM_RENDER doesn't go with USE_RENDER_CORE or the tile and sprite caches"
+#endif
+
+// SRAM set aside for the loaded card: the card RAM its mapper needs (the
+// Populous 32KB, the Arcade Card cache) and the bank cache slots
+#ifndef CARD_ARENA_SIZE
+#if USE_PSRAM_ROM
+#define CARD_ARENA_SIZE        (SRAM_BANK_SLOTS * 0x2000 + 0x2000)
+#else
+#define CARD_ARENA_SIZE        (SRAM_BANK_SLOTS * 0x2000 + 0x8000)
+#endif
+#endif
+
+// Lines of 128 bytes of the SRAM cache in front of the Arcade Card RAM in
+// PSRAM, a power of two
+#ifndef ARCADE_CARD_CACHE_LINES
+#define ARCADE_CARD_CACHE_LINES 16
+#endif
+
+// CRC-32 of the ROMs not identified by the loader, with 8 tables (8KB,
+// slice-by-8) instead of one
+#ifndef USE_CRC32_SLICE8
+#define USE_CRC32_SLICE8       1
+#endif
+
+// Fast-forward the CPU through loops waiting for an interrupt
+#ifndef USE_IDLE_LOOP_SKIP
+#define USE_IDLE_LOOP_SKIP     1
+#endif
+
+// Time the core subsystems through the osd_bench_* hooks (host benchmark only)
+#ifndef ENABLE_BENCH_TIMING
+#define ENABLE_BENCH_TIMING    0
+#endif
+
+// Profile the emulated code: per-opcode instruction and cycle counts, a PC
+// histogram by bank and 256-byte page and IO accesses by region, saved with
+// SaveProfile. Costs ~34KB of RAM and a few % of CPU time when enabled.
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER        0
+#endif
+
+// Count executed opcode pairs through osd_bench_pair (host benchmark only)
+#ifndef ENABLE_BENCH_PAIRS
+#define ENABLE_BENCH_PAIRS     0
+#endif
@@ -9,7 +9,12 @@
 #include "gfx.h"
 #include "graphics.h"
 
+#if USE_BEAM_RENDER
+// The line the display asked for, a ring of one as it's sent out right away
+#define LOCKED_LINES_MAX 1
+#else
 #define LOCKED_LINES_MAX 16
+#endif
 static __aligned(4) uint8_t LOCKED_LINE[XBUF_WIDTH * LOCKED_LINES_MAX] = { 0 };
 static int locked_line = 0;
 
@@ -28,23 +33,107 @@ static struct {
 	int latched;
 } gfx_context;
 
+/*
+	Lines to render and the context they were latched with. The VDC
+	registers the renderer needs are copied when the lines are queued, so
+	that the render core (USE_RENDER_CORE) doesn't read them as core 0
+	changes them.
+*/
+typedef struct {
+	int16_t line;
+	int16_t count;
+	int16_t scroll_x;
+	int16_t scroll_y;
+	uint16_t control;
+	uint16_t mwr;
+	uint16_t width;			// IO_VDC_SCREEN_WIDTH
+} render_job_t;
+
 static uint8_t *framebuffer_top, *framebuffer_bottom;
 
+/*
+	Decoded tile cache: the rows of a tile as the 4 bits per pixel words
+	draw_tiles builds from the 4 planes (pixels 0-7 in nibbles 1,3,5,7,0,2,4,6
+	for the PAL macro), plus which rows are fully opaque. Direct-mapped by
+	tile number, rows are decoded when first drawn so that a conflict miss
+	costs no more than drawing without the cache. pce_vram_write drops the
+	entry of a tile when its VRAM changes, gfx_reset all of them.
+*/
+#if TILE_CACHE_SIZE
+uint16_t TileCacheTag[TILE_CACHE_SIZE];
+
+static uint32_t tile_rows[TILE_CACHE_SIZE][8];
+static uint8_t tile_valid[TILE_CACHE_SIZE];		// Decoded rows, bit n for row n
+static uint8_t tile_opaque[TILE_CACHE_SIZE];	// Rows without transparent pixels
+
+static void
+tile_decode(unsigned idx, unsigned no, int first, int count)
+{
+	const uint8_t *C = (const uint8_t*)(PCE.VRAM + no * 16) + first * 2;
+	uint32_t opaque = tile_opaque[idx];
+
+	for (int row = first; row < first + count; row++, C += 2) {
+		uint32_t L, M;
+
+		M = C[0];
+		L = ((M & 0x88) >> 3) | ((M & 0x44) << 6) | ((M & 0x22) << 15) | ((M & 0x11) << 24);
+		M = C[1];
+		L |= ((M & 0x88) >> 2) | ((M & 0x44) << 7) | ((M & 0x22) << 16) | ((M & 0x11) << 25);
+		M = C[16];
+		L |= ((M & 0x88) >> 1) | ((M & 0x44) << 8) | ((M & 0x22) << 17) | ((M & 0x11) << 26);
+		M = C[17];
+		L |= ((M & 0x88) >> 0) | ((M & 0x44) << 9) | ((M & 0x22) << 18) | ((M & 0x11) << 27);
+
+		opaque |= ((C[0] | C[1] | C[16] | C[17]) == 0xFF) << row;
+		tile_rows[idx][row] = L;
+	}
+
+	tile_opaque[idx] = opaque;
+}
+
+/*
+	Cache entry of tile no with rows first..first+count-1 decoded
+*/
+static __always_inline unsigned
+tile_get(unsigned no, int first, int count)
+{
+	unsigned idx = no % TILE_CACHE_SIZE;
+	uint32_t need = ((1 << count) - 1) << first;
+
+	if (TileCacheTag[idx] != no) {
+		TileCacheTag[idx] = no;
+		tile_valid[idx] = tile_opaque[idx] = 0;
+	}
+
+	if ((tile_valid[idx] & need) != need) {
+		tile_decode(idx, no, first, count);
+		tile_valid[idx] |= need;
+		PCE.TileMisses++;
+	} else {
+		PCE.TileHits++;
+	}
+
+	return idx;
+}
+#endif
+
 /*
 	Draw background tiles between two lines
 */
 static void __always_inline
-draw_tiles(int Y1, int Y2, int scroll_x, int scroll_y)
+draw_tiles(int Y1, int Y2, const render_job_t *job)
 {
+	int scroll_x = job->scroll_x, scroll_y = job->scroll_y;
+
 	TRACE_GFX("Rendering tiles on lines %3d - %3d\tScroll: (%3d,%3d)\n", Y1, Y2, scroll_x, scroll_y);
 
 	uint32_t _bg_w[] = { 32, 64, 128, 128 };
 	uint32_t _bg_h[] = { 32, 64 };
 
-	uint32_t bg_w = _bg_w[(IO_VDC_REG[MWR].W >> 4) & 3]; // Bits 5-4 select the width
-	uint32_t bg_h = _bg_h[(IO_VDC_REG[MWR].W >> 6) & 1]; // Bit 6 selects the height
+	uint32_t bg_w = _bg_w[(job->mwr >> 4) & 3]; // Bits 5-4 select the width
+	uint32_t bg_h = _bg_h[(job->mwr >> 6) & 1]; // Bit 6 selects the height
 
-	int num_tiles = IO_VDC_SCREEN_WIDTH / 8 + 1;
+	int num_tiles = job->width / 8 + 1;
 	int x;
 	int y = Y1 + scroll_y;
 	int offset = y & 7;
@@ -63,9 +152,52 @@ draw_tiles(int Y1, int Y2, int scroll_x, int scroll_y)
 			int no = PCE.VRAM[x + y * bg_w];
 
 			uint8_t *PAL = &PCE.Palette[(no >> 8) & 0x1F0];
-			uint8_t *C = (uint8_t*)(PCE.VRAM + (no & 0x7FF) * 16 + offset);
 			uint8_t *P = PP;
 
+#if TILE_CACHE_SIZE
+			unsigned idx = tile_get(no & 0x7FF, offset, h);
+			const uint32_t *rows = tile_rows[idx] + offset;
+			uint32_t opaque = tile_opaque[idx] >> offset;
+
+			for (int i = 0; i < h; i++, P += XBUF_WIDTH, opaque >>= 1) {
+				uint32_t L = rows[i];
+
+				if (!L)
+					continue;
+
+				if (P + 8 >= framebuffer_bottom) {
+					MESSAGE_DEBUG("tile overflow!\n");
+					break;
+				} else if (P < framebuffer_top) {
+					MESSAGE_DEBUG("tile underflow!\n");
+					continue;
+				}
+
+				// No transparent pixel, no test
+				if (opaque & 1) {
+					P[0] = PAL(1);
+					P[1] = PAL(3);
+					P[2] = PAL(5);
+					P[3] = PAL(7);
+					P[4] = PAL(0);
+					P[5] = PAL(2);
+					P[6] = PAL(4);
+					P[7] = PAL(6);
+					continue;
+				}
+
+				if (L & 0x000000F0) P[0] = PAL(1);
+				if (L & 0x0000F000) P[1] = PAL(3);
+				if (L & 0x00F00000) P[2] = PAL(5);
+				if (L & 0xF0000000) P[3] = PAL(7);
+				if (L & 0x0000000F) P[4] = PAL(0);
+				if (L & 0x00000F00) P[5] = PAL(2);
+				if (L & 0x000F0000) P[6] = PAL(4);
+				if (L & 0x0F000000) P[7] = PAL(6);
+			}
+#else
+			uint8_t *C = (uint8_t*)(PCE.VRAM + (no & 0x7FF) * 16 + offset);
+
 			for (int i = 0; i < h; i++, P += XBUF_WIDTH, C += 2) {
 				uint32_t J, L, M;
 
@@ -100,6 +232,7 @@ draw_tiles(int Y1, int Y2, int scroll_x, int scroll_y)
 				if (J & 0x02) P[6] = PAL(4);
 				if (J & 0x01) P[7] = PAL(6);
 			}
+#endif
 		}
 		line += h;
 		PP += XBUF_WIDTH * h - num_tiles * 8;
@@ -110,21 +243,173 @@ draw_tiles(int Y1, int Y2, int scroll_x, int scroll_y)
 
 
 /*
-	Draw sprite C to framebuffer P
+	Decoded sprite pattern cache: each row of a 16x16 pattern as two words of
+	4 bits per pixel in the order they're drawn (P[0] in the low nibble of
+	the first), plus a mask of the non-transparent pixels. The horizontally
+	flipped copy is a second variant, built only once a sprite uses it.
+	Direct-mapped by pattern number, rows decoded when first drawn, entries
+	dropped by pce_vram_write and gfx_reset like the tile cache.
+*/
+#if SPRITE_CACHE_SIZE
+uint16_t SpriteCacheTag[SPRITE_CACHE_SIZE];
+
+typedef struct {
+	uint32_t rows[2][16][2];	// [hflip][row], pixels 0-7 and 8-15
+	uint16_t mask[2][16];		// Non-transparent pixels, bit n for P[n]
+	uint16_t valid[2];			// Decoded rows, bit n for row n
+} sprite_pattern_t;
+
+static sprite_pattern_t sprite_cache[SPRITE_CACHE_SIZE];
+
+// Bits 0-7 of V to bit 0 of nibbles 0-7
+static inline uint32_t
+spread_nibbles(uint32_t V)
+{
+	V &= 0xFF;
+	V = (V | (V << 12)) & 0x000F000F;
+	V = (V | (V << 6)) & 0x03030303;
+	V = (V | (V << 3)) & 0x11111111;
+	return V;
+}
+
+static inline uint32_t
+reverse_nibbles(uint32_t V)
+{
+	V = __builtin_bswap32(V);
+	return ((V >> 4) & 0x0F0F0F0F) | ((V & 0x0F0F0F0F) << 4);
+}
+
+static inline uint32_t
+reverse_bits16(uint32_t V)
+{
+	V = ((V >> 1) & 0x5555) | ((V & 0x5555) << 1);
+	V = ((V >> 2) & 0x3333) | ((V & 0x3333) << 2);
+	V = ((V >> 4) & 0x0F0F) | ((V & 0x0F0F) << 4);
+	V = ((V >> 8) & 0x00FF) | ((V & 0x00FF) << 8);
+	return V;
+}
+
+static void
+sprite_decode(sprite_pattern_t *S, unsigned pattern, int hflip, int first, int count)
+{
+	const uint16_t *C = PCE.VRAM + pattern * 64 + first;
+
+	for (int row = first; row < first + count; row++, C++) {
+		// Plane bit n is pixel 15-n, that's P[n] of a flipped sprite
+		uint32_t lo = spread_nibbles(C[0]) | spread_nibbles(C[16]) << 1
+			| spread_nibbles(C[32]) << 2 | spread_nibbles(C[48]) << 3;
+		uint32_t hi = spread_nibbles(C[0] >> 8) | spread_nibbles(C[16] >> 8) << 1
+			| spread_nibbles(C[32] >> 8) << 2 | spread_nibbles(C[48] >> 8) << 3;
+		uint32_t J = C[0] | C[16] | C[32] | C[48];
+
+		if (hflip) {
+			S->rows[1][row][0] = lo;
+			S->rows[1][row][1] = hi;
+			S->mask[1][row] = J;
+		} else {
+			S->rows[0][row][0] = reverse_nibbles(hi);
+			S->rows[0][row][1] = reverse_nibbles(lo);
+			S->mask[0][row] = reverse_bits16(J);
+		}
+	}
+}
+
+/*
+	Cache entry of pattern with rows first..first+count-1 of the hflip
+	variant decoded
+*/
+static __always_inline sprite_pattern_t *
+sprite_get(unsigned pattern, int hflip, int first, int count)
+{
+	unsigned idx = pattern % SPRITE_CACHE_SIZE;
+	sprite_pattern_t *S = &sprite_cache[idx];
+	uint32_t need = ((1 << count) - 1) << first;
+
+	if (SpriteCacheTag[idx] != pattern) {
+		SpriteCacheTag[idx] = pattern;
+		S->valid[0] = S->valid[1] = 0;
+	}
+
+	if ((S->valid[hflip] & need) != need) {
+		sprite_decode(S, pattern, hflip, first, count);
+		S->valid[hflip] |= need;
+		PCE.SpriteMisses++;
+	} else {
+		PCE.SpriteHits++;
+	}
+
+	return S;
+}
+
+// Eight pixels of W, all of them when M is 0xFF
+#define SPRITE_PIXELS(P, W, M) {			\
+	if ((M) == 0xFF) {						\
+		(P)[0] = PAL[(W) & 15];				\
+		(P)[1] = PAL[((W) >> 4) & 15];		\
+		(P)[2] = PAL[((W) >> 8) & 15];		\
+		(P)[3] = PAL[((W) >> 12) & 15];		\
+		(P)[4] = PAL[((W) >> 16) & 15];		\
+		(P)[5] = PAL[((W) >> 20) & 15];		\
+		(P)[6] = PAL[((W) >> 24) & 15];		\
+		(P)[7] = PAL[(W) >> 28];			\
+	} else if (M) {							\
+		for (int k = 0; k < 8; k++)			\
+			if ((M) & (1 << k))				\
+				(P)[k] = PAL[((W) >> (k * 4)) & 15]; \
+	}										\
+}
+
+/*
+	Draw height rows of the sprite cell C to framebuffer P, C being the row
+	of the top line (the bottom one of those drawn if vertically flipped)
 */
 static void __always_inline
 draw_sprite(uint8_t *P, const uint16_t *C, int height, uint32_t attr)
 {
 	uint8_t *PAL = &PCE.Palette[256 + ((attr & 0xF) << 4)];
-
-	bool hflip = attr & H_FLIP;
-	int inc = 1; //(attr & V_FLIP) ? -1 : 1;
+	unsigned offset = C - PCE.VRAM;
+	int hflip = (attr & H_FLIP) ? 1 : 0;
+	int row = offset & 15;
+	int first = row, inc = 1;
 
 	if (attr & V_FLIP) {
 		inc = -1;
-		C = C + height - 1;
+		first = row - height + 1;
 	}
 
+	sprite_pattern_t *S = sprite_get(offset >> 6, hflip, first, height);
+
+	for (int i = 0; i < height; i++, row += inc, P += XBUF_WIDTH) {
+		uint32_t M = S->mask[hflip][row];
+
+		if (!M)
+			continue;
+
+		if (P + 16 >= framebuffer_bottom) {
+			MESSAGE_DEBUG("sprite overflow %d!\n", i);
+			break;
+		} else if (P < framebuffer_top) {
+			MESSAGE_DEBUG("sprite underflow %d!\n", i);
+			continue;
+		}
+
+		SPRITE_PIXELS(P, S->rows[hflip][row][0], M & 0xFF);
+		SPRITE_PIXELS(P + 8, S->rows[hflip][row][1], M >> 8);
+	}
+}
+#else
+/*
+	Draw height rows of the sprite cell C to framebuffer P, C being the row
+	of the top line (the bottom one of those drawn if vertically flipped)
+*/
+static void __always_inline
+draw_sprite(uint8_t *P, const uint16_t *C, int height, uint32_t attr)
+{
+	uint8_t *PAL = &PCE.Palette[256 + ((attr & 0xF) << 4)];
+
+	bool hflip = attr & H_FLIP;
+	int inc = (attr & V_FLIP) ? -1 : 1;
+
 	for (int i = 0; i < height; i++, C += inc, P += XBUF_WIDTH) {
 
 		uint32_t J = C[0] | C[16] | C[32] | C[48];
@@ -198,13 +483,159 @@ draw_sprite(uint8_t *P, const uint16_t *C, int height, uint32_t attr)
 		}
 	}
 }
+#endif
+
+
+/*
+	Sprite table, decoded from the SATB after each VRAM-SATB DMA (and after
+	a reset or state load): position and size of the 64 sprites, and for
+	each line the sprites shown on it. Up to SPRITE_LINE_LIMIT cells of 16
+	pixels are shown on a line, in SATB order, further sprites are dropped
+	and raise the sprite overflow IRQ when the line is reached.
+*/
+#define SPRITE_LINES 256
+
+typedef struct {
+	int16_t x, y;			// Screen position
+	uint16_t no;			// First 16x16 cell, 64 words each
+	uint16_t attr;
+	uint8_t width;			// Cells
+	uint8_t height;			// Cells
+} sprite_info_t;
+
+typedef struct {
+	sprite_info_t info[64];
+	uint64_t lines[SPRITE_LINES];	// Bit n for sprite n
+	uint64_t front;					// Sprites drawn in front of the tiles
+	uint64_t dropped;				// Sprites missing from some of their lines
+} sprite_table_t;
+
+static int sprite_overflow_line;			// First line with too many sprites, -1 for none
+static bool sprite_table_dirty = true;
+
+/*
+	Race the beam (USE_BEAM_RENDER): the lines aren't drawn as the CPU
+	passes them, only their context is kept, one entry per line. The
+	display driver then draws each line just before it's sent out, from
+	VRAM as it is at that time, so SCREEN isn't needed for the picture.
+	The line contexts and the sprite table they're drawn with are built
+	in a back frame and published at the VBlank, a triple buffer: the
+	display only ever reads a complete frame, swapped in when it starts
+	a new one.
+*/
+#if USE_BEAM_RENDER
+#define BEAM_FRESH 4	// Published frame not taken by the display yet
+
+typedef struct {
+	render_job_t jobs[SPRITE_LINES];
+	sprite_table_t sprites;
+} beam_frame_t;
+
+static beam_frame_t beam_frames[3];
+static beam_frame_t *beam_back = &beam_frames[0];	// Core 0
+static uint8_t beam_ready = 1;						// Last published frame | BEAM_FRESH
+static uint8_t beam_shown = 2;						// Display
+
+#define sprite_table (&beam_back->sprites)
+#else
+static sprite_table_t sprite_table_data;
+
+#define sprite_table (&sprite_table_data)
+#endif
+
+static void
+sprite_table_build(void)
+{
+	pce_render_fence();
+
+#if SPRITE_LINE_LIMIT
+	uint8_t cells[SPRITE_LINES] = {0};
+#endif
+
+	sprite_table_t *T = sprite_table;
+
+	memset(T->lines, 0, sizeof(T->lines));
+	T->front = 0;
+	T->dropped = 0;
+	sprite_overflow_line = -1;
+
+	for (int n = 0; n < 64; n++) {
+		const sprite_t *spr = &PCE.SPRAM[n];
+		sprite_info_t *S = &T->info[n];
+		int cgx = (spr->attr >> 8) & 1;
+		int cgy = (spr->attr >> 12) & 3;
+
+		cgy |= cgy >> 1;
+
+		S->y = (spr->y & 0x3FF) - 64;
+		S->x = (spr->x & 0x3FF) - 32;
+		S->no = ((spr->no & 0x7FF) >> 1) & ~(cgy * 2 + cgx) & 0x1FF; // PCE has max of 512 sprites
+		S->attr = spr->attr;
+		S->width = cgx + 1;
+		S->height = cgy + 1;
+
+		if (spr->attr & 0x80)
+			T->front |= 1ULL << n;
+
+		int top = MAX(S->y, 0);
+		int bottom = MIN(S->y + S->height * 16, SPRITE_LINES);
+
+		for (int line = top; line < bottom; line++) {
+#if SPRITE_LINE_LIMIT
+			if (cells[line] + S->width > SPRITE_LINE_LIMIT) {
+				if (sprite_overflow_line < 0 || line < sprite_overflow_line)
+					sprite_overflow_line = line;
+				T->dropped |= 1ULL << n;
+				continue;
+			}
+			cells[line] += S->width;
+#endif
+			T->lines[line] |= 1ULL << n;
+		}
+	}
+
+	sprite_table_dirty = false;
+}
+
+
+/*
+	Draw lines Y1 to Y2 of sprite S
+*/
+static void __always_inline
+draw_sprite_lines(const sprite_info_t *S, int Y1, int Y2)
+{
+	uint32_t attr = S->attr;
+	int last = S->width - 1;
+
+	TRACE_SPR("Sprite : X = %d, Y = %d, attr = %d, no = %d\n", S->x, S->y, attr, S->no);
+
+	// Each row of 16x16 cells visible in Y1-Y2
+	for (int cy = (Y1 - S->y) / 16; cy < S->height && S->y + cy * 16 < Y2; cy++) {
+		int top = MAX(Y1, S->y + cy * 16);
+		int bottom = MIN(Y2, S->y + cy * 16 + 16);
+		int row = top - (S->y + cy * 16);
+		int cell = cy;
+
+		if (attr & V_FLIP) {
+			cell = S->height - 1 - cy;
+			row = 15 - row;
+		}
+
+		uint8_t *P = LOCKED_LINE + (top - locked_line) * XBUF_WIDTH + S->x;
+		const uint16_t *C = PCE.VRAM + (S->no + cell * 2) * 64 + row;
+
+		for (int j = 0; j <= last; j++) {
+			draw_sprite(P + (attr & H_FLIP ? last - j : j) * 16, C + j * 64, bottom - top, attr);
+		}
+	}
+}
 
 
 /*
 	Draw sprites between two lines
 */
 static void __always_inline // Do not inline
-draw_sprites(int Y1, int Y2, int priority)
+draw_sprites(int Y1, int Y2, int priority, const render_job_t *job, const sprite_table_t *T)
 {
 	TRACE_GFX("Rendering sprites on lines %3d - %3d\tPriority: %d\n", Y1, Y2, priority);
 
@@ -212,65 +643,45 @@ draw_sprites(int Y1, int Y2, int priority)
 	// Example: Assume that sprite #2 is priority=0 and sprite #5 is priority=1. If they
 	// overlap then sprite #5 shouldn't be drawn because #2 > #5. But currently it will.
 
-	// We iterate sprites in reverse order because earlier sprites have
-	// higher priority and therefore must overwrite later sprites.
+	uint64_t any = 0;
 
-	for (int n = 63; n >= 0; n--) {
-		const sprite_t *spr = &PCE.SPRAM[n];
-		uint32_t attr = spr->attr;
-
-		if (((attr >> 7) & 1) != priority) {
-			continue;
-		}
+	for (int line = MAX(Y1, 0); line < MIN(Y2, SPRITE_LINES); line++) {
+		any |= T->lines[line];
+	}
 
-		int y = (spr->y & 0x3FF) - 64;
-		int x = (spr->x & 0x3FF) - 32;
-		int cgx = (attr >> 8) & 1;
-		int cgy = (attr >> 12) & 3;
-		int no = (spr->no & 0x7FF);
+	any &= priority ? T->front : ~T->front;
 
-		cgy |= cgy >> 1;
+	// We iterate sprites in reverse order because earlier sprites have
+	// higher priority and therefore must overwrite later sprites.
 
-		no = (no >> 1) & ~(cgy * 2 + cgx);
-		no &= 0x1FF; // PCE has max of 512 sprites
+	for (int n = 63; any; n--) {
+		if (!((any >> n) & 1))
+			continue;
+		any &= ~(1ULL << n);
 
-		TRACE_SPR("Sprite 0x%02X : X = %d, Y = %d, attr = %d, no = %d\n", n, x, y, attr, no);
+		const sprite_info_t *S = &T->info[n];
 
 		// Sprite is completely outside our window, skip it
-		if (y >= Y2 || y + (cgy + 1) * 16 < Y1 || x >= IO_VDC_SCREEN_WIDTH || x + (cgx + 1) * 16 < 0) {
+		if (S->x >= job->width || S->x + S->width * 16 < 0) {
 			continue;
 		}
 
-		cgy *= 16;
-
-        int yi = y - locked_line;
-		uint8_t *P = LOCKED_LINE + ((attr & V_FLIP ? cgy + yi : yi) * XBUF_WIDTH) + x;
-		uint16_t *C = PCE.VRAM + (no * 64);
-
-		for (int yy = 0; yy <= cgy; yy += 16) {
-			int height = 16;
-			if (attr & V_FLIP) {
-				height = MIN(16, Y2 - yi - (cgy - yy));
-			} else {
-				int t = Y1 - y - yy;
-				if (t > 0) {
-					P += t * XBUF_WIDTH;
-					C += t;
-					height -= t;
-				}
-				height = MIN(height, Y2 - y - yy);
-			}
+		if (!((T->dropped >> n) & 1)) {
+			draw_sprite_lines(S, MAX(Y1, S->y), MIN(Y2, S->y + S->height * 16));
+			continue;
+		}
 
-			if (height > 0) {
-				for (int j = 0; j <= cgx; j++) {
-					draw_sprite(P + (attr & H_FLIP ? cgx - j : j) * 16, C + j * 64, height, attr);
-				}
-			} else {
-				MESSAGE_DEBUG("negative sprite height!\n");
+		// Dropped on some of the lines by the sprite limit, draw the runs
+		// of lines where it's shown
+		for (int line = MAX(Y1, 0); line < MIN(Y2, SPRITE_LINES); ) {
+			if (!((T->lines[line] >> n) & 1)) {
+				line++;
+				continue;
 			}
-
-			P += ((attr & V_FLIP) ? -height : height) * XBUF_WIDTH;
-			C += height + 16 * 7;
+			int start = line;
+			while (line < MIN(Y2, SPRITE_LINES) && ((T->lines[line] >> n) & 1))
+				line++;
+			draw_sprite_lines(S, start, line);
 		}
 	}
 }
@@ -316,42 +727,178 @@ gfx_latch_context(int force)
 extern uint8_t SCREEN[];
 
 /*
-	Render lines into the buffer from min_line to max_line (inclusive)
+	Render sz lines from ln into LOCKED_LINE
 */
 static __always_inline void
-render_line(int ln, int sz) {
-	gfx_context.latched = 0;
-
+render_line(const render_job_t *job, const sprite_table_t *sprites, int ln, int sz) {
     // We must fill the region with color 0 first.
     memset(LOCKED_LINE, PCE.Palette[0], XBUF_WIDTH * sz);
     locked_line = ln;
 
 	// Sprites with priority 0 are drawn behind the tiles
-	if (gfx_context.control & 0x40) {
-		draw_sprites(ln, ln + sz, 0);
+	if (job->control & 0x40) {
+		draw_sprites(ln, ln + sz, 0, job, sprites);
 	}
 
 	// Draw the background tiles
-	if (gfx_context.control & 0x80) {
-		draw_tiles(ln, ln + sz, gfx_context.scroll_x, gfx_context.scroll_y);
+	if (job->control & 0x80) {
+		draw_tiles(ln, ln + sz, job);
 	}
 
 	// Draw regular sprites
-	if (gfx_context.control & 0x40) {
-		draw_sprites(ln, ln + sz, 1);
+	if (job->control & 0x40) {
+		draw_sprites(ln, ln + sz, 1, job, sprites);
+	}
+}
+
+#if !USE_BEAM_RENDER
+static void __time_critical_func(render_job)(const render_job_t *job) {
+	int max_line = job->line + job->count;
+	for(int ln = job->line; ln < max_line; ln += LOCKED_LINES_MAX) {
+		int sz = max_line - ln > LOCKED_LINES_MAX ? LOCKED_LINES_MAX : max_line - ln;
+		render_line(job, sprite_table, ln, sz);
+		// we will show this line for the time line is rendering
+		memcpy(SCREEN + (ln * XBUF_WIDTH), LOCKED_LINE, XBUF_WIDTH * sz);
 	}
+}
+#endif
+
+#if USE_BEAM_RENDER
+/*
+	Draw line y of the shown frame, called by the display driver
+*/
+uint8_t *__time_critical_func(gfx_beam_line)(int y)
+{
+	static const render_job_t blank = { .count = 1 };
+	static int last_y;
+	const render_job_t *job = &blank;
 
-	// we will show this line for the time line is rendering
-	uint8_t * buf = SCREEN + (ln * XBUF_WIDTH);
+	// The display starts a new frame, take the last one published
+	if (y < last_y && (__atomic_load_n(&beam_ready, __ATOMIC_RELAXED) & BEAM_FRESH))
+		beam_shown = __atomic_exchange_n(&beam_ready, beam_shown, __ATOMIC_ACQ_REL) & 3;
+	last_y = y;
 
-	memcpy(buf, LOCKED_LINE, XBUF_WIDTH * sz);
+	const beam_frame_t *frame = &beam_frames[beam_shown];
+
+	if (y >= 0 && y < SPRITE_LINES)
+		job = &frame->jobs[y];
+
+	render_line(job, &frame->sprites, y, 1);
+	return LOCKED_LINE;
 }
 
-static __always_inline void
+/*
+	Hand the back frame to the display and carry it over to the next one,
+	the lines it doesn't queue and the sprite table stay the same
+*/
+static void
+beam_publish(void)
+{
+	int back = beam_back - beam_frames;
+	int prev = __atomic_exchange_n(&beam_ready, back | BEAM_FRESH, __ATOMIC_ACQ_REL) & 3;
+
+	beam_back = &beam_frames[prev];
+	*beam_back = beam_frames[back];
+}
+#endif
+
+/*
+	Render journal: lines queued by core 0 for the render core, a single
+	producer single consumer ring. Core 0 waits for it to drain
+	(pce_render_fence) before it changes what the queued lines are drawn
+	from: VRAM, the palette, the sprite table.
+*/
+#if USE_RENDER_CORE
+#define RENDER_JOURNAL_SIZE 32
+
+static render_job_t render_journal[RENDER_JOURNAL_SIZE];
+uint32_t RenderJournalHead, RenderJournalTail;
+static volatile bool render_async;
+
+static void
+render_journal_push(const render_job_t *job)
+{
+	uint32_t head = RenderJournalHead;
+
+	// Full, wait for the render core
+	while (head - __atomic_load_n(&RenderJournalTail, __ATOMIC_ACQUIRE) >= RENDER_JOURNAL_SIZE)
+		tight_loop_contents();
+
+	render_journal[head % RENDER_JOURNAL_SIZE] = *job;
+	__atomic_store_n(&RenderJournalHead, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+	Render the queued lines, called in a loop by the render core
+*/
+void __time_critical_func(gfx_render_journal)(void)
+{
+	uint32_t tail = RenderJournalTail;
+
+	while (tail != __atomic_load_n(&RenderJournalHead, __ATOMIC_ACQUIRE)) {
+		render_job(&render_journal[tail % RENDER_JOURNAL_SIZE]);
+		__atomic_store_n(&RenderJournalTail, ++tail, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+	Wait until the render core has drawn all the queued lines
+*/
+void
+gfx_render_sync(void)
+{
+	while (__atomic_load_n(&RenderJournalTail, __ATOMIC_ACQUIRE) != RenderJournalHead)
+		tight_loop_contents();
+}
+
+/*
+	Queue the lines for gfx_render_journal (true) or draw them in gfx_run
+*/
+void
+gfx_render_async(bool on)
+{
+	gfx_render_sync();
+	render_async = on;
+}
+#endif
+
+/*
+	Queue or draw lines min_line to max_line with the latched context
+*/
+static void
 render_lines(int min_line, int max_line) {
-	for(int ln = min_line; ln < max_line; ln += LOCKED_LINES_MAX) {
-		render_line(ln, max_line - ln > LOCKED_LINES_MAX ? LOCKED_LINES_MAX : max_line - ln);
+	if (min_line >= max_line)
+		return;
+
+	render_job_t job = {
+		.line = min_line,
+		.count = max_line - min_line,
+		.scroll_x = gfx_context.scroll_x,
+		.scroll_y = gfx_context.scroll_y,
+		.control = gfx_context.control,
+		.mwr = IO_VDC_REG[MWR].W,
+		.width = IO_VDC_SCREEN_WIDTH,
+	};
+
+	gfx_context.latched = 0;
+
+#if USE_BEAM_RENDER
+	job.count = 1;
+	for (int ln = min_line; ln < max_line && ln < SPRITE_LINES; ln++) {
+		job.line = ln;
+		beam_back->jobs[ln] = job;
 	}
+	return;
+#endif
+#if USE_RENDER_CORE
+	if (render_async) {
+		render_journal_push(&job);
+		return;
+	}
+#endif
+#if !USE_BEAM_RENDER
+	render_job(&job);
+#endif
 }
 
 int
@@ -368,8 +915,21 @@ gfx_init(void)
 void
 gfx_reset(bool hard)
 {
+	pce_render_fence();
+
 	last_line_counter = 0;
 	line_counter = 0;
+
+#if TILE_CACHE_SIZE
+	// VRAM may have been reloaded
+	memset(TileCacheTag, 0xFF, sizeof(TileCacheTag));
+#endif
+#if SPRITE_CACHE_SIZE
+	memset(SpriteCacheTag, 0xFF, sizeof(SpriteCacheTag));
+#endif
+
+	// SPRAM may have been cleared or reloaded
+	sprite_table_dirty = true;
 }
 
 
@@ -414,6 +974,10 @@ void __time_critical_func(gfx_run)(void)
 {
 	int scanline = PCE.Scanline;
 
+	if (sprite_table_dirty) {
+		sprite_table_build();
+	}
+
 	/* DMA Transfer in "progress" */
 	if (PCE.VDC.satb > DMA_TRANSFER_COUNTER) {
 		if (--PCE.VDC.satb == DMA_TRANSFER_COUNTER) {
@@ -441,6 +1005,9 @@ void __time_critical_func(gfx_run)(void)
 		}
 
 		if (scanline >= IO_VDC_MINLINE && scanline <= IO_VDC_MAXLINE) {
+			if (line_counter == sprite_overflow_line && OverON && SpriteON) {
+				gfx_irq(VDC_STAT_OR);
+			}
 			if (gfx_context.latched) {
 				render_lines(last_line_counter, line_counter);
 				last_line_counter = line_counter;
@@ -454,6 +1021,9 @@ void __time_critical_func(gfx_run)(void)
 		// Draw any lines left in the context
 		gfx_latch_context(0);
 		render_lines(last_line_counter, line_counter);
+#if USE_BEAM_RENDER
+		beam_publish();
+#endif
 
 		// Trigger interrupts
 		if (SpHitON && sprite_hit_check()) {
@@ -465,8 +1035,11 @@ void __time_critical_func(gfx_run)(void)
 
 		/* VRAM to SATB DMA */
 		if (PCE.VDC.satb == DMA_TRANSFER_PENDING || AutoSATBON) {
-			memcpy(PCE.SPRAM, PCE.VRAM + IO_VDC_REG[SATB].W, 512);
+			uint16_t *satb = (uint16_t *)PCE.SPRAM;
+			for (int i = 0; i < 256; i++)
+				satb[i] = PCE.VRAM[(IO_VDC_REG[SATB].W + i) & 0x7FFF];
 			PCE.VDC.satb = DMA_TRANSFER_COUNTER + 4;
+			sprite_table_build();
 		}
 	}
 	/* V Blank area */
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 int gfx_init(void);
 void gfx_run(void);
@@ -8,3 +9,9 @@ void gfx_term(void);
 void gfx_irq(int type);
 void gfx_reset(bool hard);
 void gfx_latch_context(int force);
+// USE_RENDER_CORE
+void gfx_render_journal(void);
+void gfx_render_sync(void);
+void gfx_render_async(bool on);
+// USE_BEAM_RENDER
+uint8_t *gfx_beam_line(int y);
@@ -7,6 +7,7 @@ void h6280_run(int cycles);
 void h6280_irq(int);
 void h6280_dump_state(void);
 void h6280_disassemble(void);
+const char *h6280_opcode_name(uint8_t opcode);
 
 typedef struct
 {
@@ -28,6 +29,25 @@ typedef struct
 	uint32_t halted;
 } h6280_t;
 
+/* Registers held in locals by h6280_run for the duration of a slice */
+typedef struct
+{
+	uint16_t PC;
+	uint8_t A;
+	uint8_t X;
+	uint8_t Y;
+	uint8_t P;
+	uint8_t S;
+	uint16_t NZ; // USE_LAZY_FLAGS
+	int32_t cycles;
+	int32_t max_cycles;
+	/* Current instruction and the code window it was fetched from */
+	const uint8_t *ip;
+	const uint8_t *win;
+	uint16_t win_pc;
+	uint16_t win_len;
+} h6280_regs_t;
+
 // CPU Flags:
 #define FL_N       0x80
 #define FL_V       0x40
@@ -0,0 +1,14 @@
+// h6280_fusetable.h - Opcode pairs run as one handler (superinstructions)
+//
+// Included by h6280.c with FUSED(a, fa, b, fb) defined when
+// USE_SUPERINSTRUCTIONS is set. Opcode a runs fa, then fb right away if the
+// next opcode is b, skipping the dispatch table and letting the compiler
+// fold the flags set by fa into the test in fb. One pair per first opcode.
+//
+FUSED(0xCA, dex(cpu), 0xD0, bne(cpu))				// DEX; BNE
+FUSED(0x88, dey(cpu), 0xD0, bne(cpu))				// DEY; BNE
+FUSED(0xC9, cmp_imm(cpu), 0xD0, bne(cpu))			// CMP #$nn; BNE
+FUSED(0xC0, cpy_imm(cpu), 0xD0, bne(cpu))			// CPY #$nn; BNE
+FUSED(0xA5, lda_zp(cpu), 0x8D, sta_abs(cpu))		// LDA $ZZ; STA $hhll
+FUSED(0xA9, lda_imm(cpu), 0x8D, sta_abs(cpu))		// LDA #$nn; STA $hhll
+FUSED(0xB1, lda_zpindy(cpu), 0x91, sta_zpindy(cpu))	// LDA (IND),Y; STA (IND),Y
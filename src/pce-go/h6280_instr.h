@@ -43,20 +43,124 @@ static const UBYTE bcd2bin[0x100] = {
 // pointer to the beginning of the Stack Area
 #define SP_BASE (PCE.RAM + 0x100)
 
-// Addressing modes:
-#define imm_operand(addr)  ({uint32_t a = (addr); PageR[a >> 13][a];})
-#define abs_operand(x)     pce_read8(pce_read16(x))
-#define absx_operand(x)    pce_read8(pce_read16(x)+CPU.X)
-#define absy_operand(x)    pce_read8(pce_read16(x)+CPU.Y)
-#define zp_operand(x)      get_8bit_zp(imm_operand(x))
-#define zpx_operand(x)     get_8bit_zp(imm_operand(x)+CPU.X)
-#define zpy_operand(x)     get_8bit_zp(imm_operand(x)+CPU.Y)
-#define zpind_operand(x)   pce_read8(get_16bit_zp(imm_operand(x)))
-#define zpindx_operand(x)  pce_read8(get_16bit_zp(imm_operand(x)+CPU.X))
-#define zpindy_operand(x)  pce_read8(get_16bit_zp(imm_operand(x))+CPU.Y)
+// Register file access. The registers live in h6280_run's locals for the
+// whole slice and are only copied to PCE.CPU at slice exit. The IO handlers
+// only get what they look at: PC (messages), P (pce_schedule, which only
+// tests FL_I so N and Z needn't be rebuilt) and Cycles.
+#define regs_load(r) { (r)->PC = CPU.PC; (r)->A = CPU.A; (r)->X = CPU.X;	\
+	(r)->Y = CPU.Y; set_flags(r, CPU.P); (r)->S = CPU.S; (r)->cycles = PCE.Cycles; \
+	(r)->win = NULL; (r)->win_pc = 0; (r)->win_len = 0; }
+#define regs_store(r) { CPU.PC = (r)->PC; CPU.A = (r)->A; CPU.X = (r)->X;	\
+	CPU.Y = (r)->Y; CPU.P = get_flags(r); CPU.S = (r)->S; PCE.Cycles = (r)->cycles; }
+#define regs_sync(r) { CPU.PC = (r)->PC; CPU.P = (r)->P; PCE.Cycles = (r)->cycles; }
+
+// Flags N and Z. With USE_LAZY_FLAGS they aren't kept in P but derived from
+// NZ when P is read as a whole (PHP, BRK, interrupts, slice exit): the low
+// byte is the last result (Z), N is bit 7 of either byte. The high byte is
+// only needed by BIT/TST, where N comes from the operand and Z from A & M.
+#if USE_LAZY_FLAGS
+#define get_flags(r) (((r)->P & ~(FL_N | FL_Z)) | (((r)->NZ & 0xFF) ? 0 : FL_Z) | (((r)->NZ & 0x8080) ? FL_N : 0))
+#define set_flags(r, p) { (r)->P = (p); (r)->NZ = (((r)->P & FL_Z) ? 0 : 1) | ((r)->P & FL_N) << 8; }
+#define set_nz(x) cpu->NZ = (x)
+#define set_nz_bit(m, x) cpu->NZ = (x) | ((m) & FL_N) << 8
+#define flag_n() (cpu->NZ & 0x8080)
+#define flag_z() (!(cpu->NZ & 0xFF))
+#else
+#define get_flags(r) ((r)->P)
+#define set_flags(r, p) (r)->P = (p)
+#define set_nz(x) cpu->P = (cpu->P & ~(FL_N | FL_Z)) | FLAG_NZ(x)
+#define set_nz_bit(m, x) cpu->P = (cpu->P & ~(FL_N | FL_Z)) | ((m) & FL_N) | ((x) ? 0 : FL_Z)
+#define flag_n() (cpu->P & FL_N)
+#define flag_z() (cpu->P & FL_Z)
+#endif
+
+// Memory access from opcode handlers (same as pce_read8/pce_write8 with a
+// register sync before entering the bank handlers). Handler writes may
+// reschedule the end of the slice (timer start, IRQ mask, VDC DMA) or remap
+// the code window (SF2 mapper).
+#define cpu_read8(addr) ({							\
+	uint16_t a = (addr);							\
+	uint8_t *page = PageR[a >> 13];					\
+	uint8_t v;										\
+	if (page) {										\
+		v = page[a];								\
+	} else {										\
+		regs_sync(cpu);							\
+		v = pce_readHandler(a);						\
+	}												\
+	v;												\
+})
+
+#define cpu_write_handler(a, b) {					\
+	regs_sync(cpu);								\
+	pce_writeHandler(a, b);							\
+	cpu->max_cycles = PCE.NextEvent;				\
+	cpu->win_len = 0;								\
+}
+
+#define cpu_write8(addr, byte) {					\
+	uint16_t a = (addr); uint8_t b = (byte);		\
+	uint8_t *page = PageW[a >> 13];					\
+	if (page) {										\
+		page[a] = b;								\
+	} else {										\
+		cpu_write_handler(a, b);					\
+	}												\
+}
+
+// Absolute stores, the usual way to write the VDC ports: register select
+// and VRAM data writes to $0000-$0003 of the IO page skip the IO decode
+#define cpu_write8_abs(addr, byte) {				\
+	uint16_t a = (addr); uint8_t b = (byte);		\
+	uint8_t *page = PageW[a >> 13];					\
+	if (page) {										\
+		page[a] = b;								\
+	} else if ((a & 0x1FFC) || pce_handlerW(a) != MAP_IO || !pce_vdc_write_fast(a, b)) { \
+		cpu_write_handler(a, b);					\
+	}												\
+}
+
+#define cpu_writeIO(addr, byte) {					\
+	uint8_t b = (byte);								\
+	regs_sync(cpu);								\
+	pce_writeIO(addr, b);							\
+	cpu->max_cycles = PCE.NextEvent;				\
+	cpu->win_len = 0;								\
+}
+
+// ST0/ST1/ST2
+#define cpu_writeVDC(addr, byte) {					\
+	uint8_t v = (byte);								\
+	if (!pce_vdc_write_fast(addr, v))				\
+		cpu_writeIO(addr, v);						\
+}
+
+// End the slice after this instruction if clearing FL_I unmasked a pending
+// IRQ, h6280_run takes it at the start of the next slice
+#define chk_irq_pending() {							\
+	if (!(cpu->P & FL_I) && (CPU.irq_lines & ~CPU.irq_mask & INT_MASK)) \
+		cpu->max_cycles = cpu->cycles;				\
+}
+
+// Instruction stream: byte k of the current instruction, cpu->ip is set up
+// by h6280_run's opcode fetch (see code_window)
+#define imm_operand(addr)  ({uint32_t a = (addr); code_page(a >> 13)[a];})
+#define insn8(k)           (cpu->ip[k])
+#define insn16(k)          (cpu->ip[k] | cpu->ip[(k) + 1] << 8)
+
+// Addressing modes, k is the operand's offset in the instruction:
+#define abs_operand(k)     cpu_read8(insn16(k))
+#define absx_operand(k)    cpu_read8(insn16(k)+cpu->X)
+#define absy_operand(k)    cpu_read8(insn16(k)+cpu->Y)
+#define zp_operand(k)      get_8bit_zp(insn8(k))
+#define zpx_operand(k)     get_8bit_zp(insn8(k)+cpu->X)
+#define zpy_operand(k)     get_8bit_zp(insn8(k)+cpu->Y)
+#define zpind_operand(k)   cpu_read8(get_16bit_zp(insn8(k)))
+#define zpindx_operand(k)  cpu_read8(get_16bit_zp(insn8(k)+cpu->X))
+#define zpindy_operand(k)  cpu_read8(get_16bit_zp(insn8(k))+cpu->Y)
 
 // Flag check (flags 'N' and 'Z'):
-#define chk_flnz_8bit(x) CPU.P = ((CPU.P & (~(FL_N|FL_T|FL_Z))) | FLAG_NZ(x));
+#define chk_flnz_8bit(x) { cpu->P &= ~FL_T; set_nz(x); }
 
 // Zero page access
 #define get_8bit_zp(zp_addr) ZP_BASE[(zp_addr) & 0xFF]
@@ -64,26 +168,68 @@ static const UBYTE bcd2bin[0x100] = {
 #define put_8bit_zp(zp_addr, byte) ZP_BASE[(zp_addr) & 0xFF] = (byte)
 
 // Stack access
-#define push_8bit(byte) ({*(SP_BASE + CPU.S) = (byte); CPU.S--;})
+#define push_8bit(byte) ({*(SP_BASE + cpu->S) = (byte); cpu->S--;})
 #define push_16bit(addr) ({UWORD x = addr; push_8bit(x >> 8); push_8bit(x & 0xFF);})
-//#define pull_8bit() (*(SP_BASE + ++CPU.S))
-#define pull_8bit(x) ({ ++CPU.S; x = *(SP_BASE + CPU.S);})
+//#define pull_8bit() (*(SP_BASE + ++cpu->S))
+#define pull_8bit(x) ({ ++cpu->S; x = *(SP_BASE + cpu->S);})
 //#define pull_16bit() (pull_8bit() | pull_8bit() << 8)
 
+//
+// Code windows: the opcode fetch points cpu->ip at the current instruction
+// inside a window of code valid for PCs in [win_pc, win_pc + win_len), so
+// operands are read without going through PageR. A window is the page the
+// code runs in, used in place: RAM, ROM in flash, or its copy in the SRAM
+// bank cache (SRAM_BANK_SLOTS).
+//
+#define CODE_LINE_SLACK 6 // bytes following the last opcode (TII & co are 7 bytes)
+
+static struct {
+	const uint8_t *win;
+	uint16_t win_pc;
+	uint16_t win_len;
+} code_win;
+
+static uint8_t code_tail[CODE_LINE_SLACK + 1];
+
+// Code is read from the banks behind a handler (IO page) as from NULLRAM,
+// without the side effects of the register reads
+#define code_page(page)    (PageR[page] ? PageR[page] : PCE.NULLRAM - ((page) << 13))
+
+// Opcode fetch slow path, sets up code_win for pc and returns the instruction
+static __attribute__((noinline)) const uint8_t *
+code_window(uint16_t pc)
+{
+	unsigned page = pc >> 13;
+	uint8_t *base = code_page(page);
+
+	// An instruction running into the next page is read byte by byte
+	if ((pc & 0x1FFF) >= 0x2000 - CODE_LINE_SLACK) {
+		for (int i = 0; i <= CODE_LINE_SLACK; i++)
+			code_tail[i] = imm_operand((uint16_t)(pc + i));
+		code_win.win_len = 0;
+		return code_tail;
+	}
+
+	code_win.win = base + (page << 13);
+	code_win.win_pc = page << 13;
+	code_win.win_len = 0x2000 - CODE_LINE_SLACK;
+	return base + pc;
+}
+
 //
 // Implementation of actual opcodes:
 //
 
-static inline UBYTE
-adc(UBYTE acc, UBYTE val)
+static ALWAYS_INLINE UBYTE
+adc(h6280_regs_t *cpu, UBYTE acc, UBYTE val)
 {
 	/* binary mode */
-	if (!(CPU.P & FL_D))
+	if (!(cpu->P & FL_D))
 	{
 		SWORD sig = (SBYTE)acc;
 		UWORD usig = (UBYTE)acc;
 
-		if (CPU.P & FL_C)
+		if (cpu->P & FL_C)
 		{
 			usig++;
 			sig++;
@@ -92,7 +238,8 @@ adc(UBYTE acc, UBYTE val)
 		usig += (UBYTE)val;
 		acc = (UBYTE)(usig & 0xFF);
 
-		CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z | FL_C)) | (((sig > 127) || (sig < -128)) ? FL_V : 0) | ((usig > 255) ? FL_C : 0) | FLAG_NZ(acc);
+		cpu->P = (cpu->P & ~(FL_V | FL_T | FL_C)) | (((sig > 127) || (sig < -128)) ? FL_V : 0) | ((usig > 255) ? FL_C : 0);
+		set_nz(acc);
 	}
 
 	/* decimal mode */
@@ -100,16 +247,17 @@ adc(UBYTE acc, UBYTE val)
 	{
 		uint32_t temp = bcd2bin[acc] + bcd2bin[val];
 
-		if (CPU.P & FL_C)
+		if (cpu->P & FL_C)
 		{
 			temp++;
 		}
 
 		acc = bin2bcd[temp];
 
-		CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp > 99) ? FL_C : 0) | FLAG_NZ(acc);
+		cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp > 99) ? FL_C : 0);
+		set_nz(acc);
 
-		Cycles++; /* decimal mode takes an extra cycle */
+		cpu->cycles++; /* decimal mode takes an extra cycle */
 	}
 
 	return acc;
@@ -117,2183 +265,2623 @@ adc(UBYTE acc, UBYTE val)
 
 
 static ALWAYS_INLINE void
-sbc(UBYTE val)
+sbc(h6280_regs_t *cpu, UBYTE val)
 {
 	/* binary mode */
-	if (!(CPU.P & FL_D))
+	if (!(cpu->P & FL_D))
 	{
-		SWORD sig = (SBYTE)CPU.A;
-		UWORD usig = (UBYTE)CPU.A;
+		SWORD sig = (SBYTE)cpu->A;
+		UWORD usig = (UBYTE)cpu->A;
 
-		if (!(CPU.P & FL_C))
+		if (!(cpu->P & FL_C))
 		{
 			usig--;
 			sig--;
 		}
 		sig -= (SBYTE)val;
 		usig -= (UBYTE)val;
-		CPU.A = (UBYTE)(usig & 0xFF);
-		CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z | FL_C)) | (((sig > 127) || (sig < -128)) ? FL_V : 0) | ((usig > 255) ? 0 : FL_C) | FLAG_NZ(CPU.A);
+		cpu->A = (UBYTE)(usig & 0xFF);
+		cpu->P = (cpu->P & ~(FL_V | FL_T | FL_C)) | (((sig > 127) || (sig < -128)) ? FL_V : 0) | ((usig > 255) ? 0 : FL_C);
+		set_nz(cpu->A);
 	}
 
 	/* decimal mode */
 	else
 	{
-		int temp = (int)bcd2bin[CPU.A] - bcd2bin[val];
+		int temp = (int)bcd2bin[cpu->A] - bcd2bin[val];
 
-		if (!(CPU.P & FL_C))
+		if (!(cpu->P & FL_C))
 		{
 			temp--;
 		}
 
-		CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp < 0) ? 0 : FL_C);
+		cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp < 0) ? 0 : FL_C);
 
 		while (temp < 0)
 		{
 			temp += 100;
 		}
 
-		CPU.A = bin2bcd[temp];
-		chk_flnz_8bit(CPU.A);
+		cpu->A = bin2bcd[temp];
+		chk_flnz_8bit(cpu->A);
 
-		Cycles++; /* decimal mode takes an extra cycle */
+		cpu->cycles++; /* decimal mode takes an extra cycle */
 	}
 }
 
-OPCODE_FUNC adc_abs(void)
+OPCODE_FUNC adc_abs(h6280_regs_t *cpu)
 {
 	// if flag 'T' is set, use zero-page address specified by register 'X'
 	// as the accumulator...
 
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), abs_operand(CPU.PC + 1)));
-		Cycles += 8;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), abs_operand(1)));
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, abs_operand(CPU.PC + 1));
-		Cycles += 5;
+		cpu->A = adc(cpu, cpu->A, abs_operand(1));
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC adc_absx(void)
+OPCODE_FUNC adc_absx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), absx_operand(CPU.PC + 1)));
-		Cycles += 8;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), absx_operand(1)));
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, absx_operand(CPU.PC + 1));
-		Cycles += 5;
+		cpu->A = adc(cpu, cpu->A, absx_operand(1));
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC adc_absy(void)
+OPCODE_FUNC adc_absy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), absy_operand(CPU.PC + 1)));
-		Cycles += 8;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), absy_operand(1)));
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, absy_operand(CPU.PC + 1));
-		Cycles += 5;
+		cpu->A = adc(cpu, cpu->A, absy_operand(1));
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC adc_imm(void)
+OPCODE_FUNC adc_imm(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), imm_operand(CPU.PC + 1)));
-		Cycles += 5;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), insn8(1)));
+		cpu->cycles += 5;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, imm_operand(CPU.PC + 1));
-		Cycles += 2;
+		cpu->A = adc(cpu, cpu->A, insn8(1));
+		cpu->cycles += 2;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC adc_zp(void)
+OPCODE_FUNC adc_zp(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), zp_operand(CPU.PC + 1)));
-		Cycles += 7;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), zp_operand(1)));
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, zp_operand(CPU.PC + 1));
-		Cycles += 4;
+		cpu->A = adc(cpu, cpu->A, zp_operand(1));
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC adc_zpx(void)
+OPCODE_FUNC adc_zpx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), zpx_operand(CPU.PC + 1)));
-		Cycles += 7;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), zpx_operand(1)));
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, zpx_operand(CPU.PC + 1));
-		Cycles += 4;
+		cpu->A = adc(cpu, cpu->A, zpx_operand(1));
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC adc_zpind(void)
+OPCODE_FUNC adc_zpind(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), zpind_operand(CPU.PC + 1)));
-		Cycles += 10;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), zpind_operand(1)));
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, zpind_operand(CPU.PC + 1));
-		Cycles += 7;
+		cpu->A = adc(cpu, cpu->A, zpind_operand(1));
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC adc_zpindx(void)
+OPCODE_FUNC adc_zpindx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), zpindx_operand(CPU.PC + 1)));
-		Cycles += 10;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), zpindx_operand(1)));
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, zpindx_operand(CPU.PC + 1));
-		Cycles += 7;
+		cpu->A = adc(cpu, cpu->A, zpindx_operand(1));
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC adc_zpindy(void)
+OPCODE_FUNC adc_zpindy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		put_8bit_zp(CPU.X, adc(get_8bit_zp(CPU.X), zpindy_operand(CPU.PC + 1)));
-		Cycles += 10;
+		put_8bit_zp(cpu->X, adc(cpu, get_8bit_zp(cpu->X), zpindy_operand(1)));
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A = adc(CPU.A, zpindy_operand(CPU.PC + 1));
-		Cycles += 7;
+		cpu->A = adc(cpu, cpu->A, zpindy_operand(1));
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC and_abs(void)
+OPCODE_FUNC and_abs(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= abs_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= abs_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A &= abs_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A &= abs_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC and_absx(void)
+OPCODE_FUNC and_absx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= absx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= absx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A &= absx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A &= absx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC and_absy(void)
+OPCODE_FUNC and_absy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= absy_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= absy_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A &= absy_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A &= absy_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC and_imm(void)
+OPCODE_FUNC and_imm(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= imm_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= insn8(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 5;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 5;
 	}
 	else
 	{
-		CPU.A &= imm_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 2;
+		cpu->A &= insn8(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 2;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC and_zp(void)
+OPCODE_FUNC and_zp(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= zp_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= zp_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 7;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A &= zp_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 4;
+		cpu->A &= zp_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC and_zpx(void)
+OPCODE_FUNC and_zpx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= zpx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= zpx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 7;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A &= zpx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 4;
+		cpu->A &= zpx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC and_zpind(void)
+OPCODE_FUNC and_zpind(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= zpind_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= zpind_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A &= zpind_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A &= zpind_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC and_zpindx(void)
+OPCODE_FUNC and_zpindx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= zpindx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= zpindx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A &= zpindx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A &= zpindx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC and_zpindy(void)
+OPCODE_FUNC and_zpindy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp &= zpindy_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp &= zpindy_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A &= zpindy_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A &= zpindy_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC asl_a(void)
+OPCODE_FUNC asl_a(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.A;
-	CPU.A <<= 1;
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp & 0x80) ? FL_C : 0) | FLAG_NZ(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	UBYTE temp = cpu->A;
+	cpu->A <<= 1;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp & 0x80) ? FL_C : 0);
+	set_nz(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC asl_abs(void)
+OPCODE_FUNC asl_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp1 = pce_read8(temp_addr);
+	UWORD temp_addr = insn16(1);
+	UBYTE temp1 = cpu_read8(temp_addr);
 	UBYTE temp = temp1 << 1;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC asl_absx(void)
+OPCODE_FUNC asl_absx(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1) + CPU.X;
-	UBYTE temp1 = pce_read8(temp_addr);
+	UWORD temp_addr = insn16(1) + cpu->X;
+	UBYTE temp1 = cpu_read8(temp_addr);
 	UBYTE temp = temp1 << 1;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC asl_zp(void)
+OPCODE_FUNC asl_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp1 = get_8bit_zp(zp_addr);
 	UBYTE temp = temp1 << 1;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC asl_zpx(void)
+OPCODE_FUNC asl_zpx(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1) + CPU.X;
+	UBYTE zp_addr = insn8(1) + cpu->X;
 	UBYTE temp1 = get_8bit_zp(zp_addr);
 	UBYTE temp = temp1 << 1;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC bbr(UBYTE bit)
+#if USE_IDLE_LOOP_SKIP
+// Idle loop detection
+//
+// Games wait for vblank or a timer IRQ in short loops that only read memory
+// (BRA *, LDA $xx / BEQ, polling the VDC status...). Interrupts and timer ticks
+// only happen between CPU slices, so if two consecutive iterations of such a
+// loop end with the same registers, every following iteration is identical
+// until the end of the slice and we can fast-forward the cycle counter.
+
+#define IDLE_LOOP_MAX_SIZE	16
+
+// Instructions allowed in the body of an idle loop, they don't write memory
+// nor touch the stack. Low nibble is the instruction length.
+#define IDLE_REG			0x10	/* registers, immediate or zero page */
+#define IDLE_ABS			0x20	/* absolute read, checked for IO side effects */
+#define IDLE_ABSX			0x30	/* indexed absolute read, must not reach IO */
+#define IDLE_BRANCH			0x40	/* relative branch, BBR/BBS */
+
+static const uint8_t idle_ops[0x100] = {
+	[0x02] = 1 | IDLE_REG,		// SXY
+	[0x05] = 2 | IDLE_REG,		// ORA $ZZ
+	[0x09] = 2 | IDLE_REG,		// ORA #$nn
+	[0x0A] = 1 | IDLE_REG,		// ASL A
+	[0x0D] = 3 | IDLE_ABS,		// ORA $hhll
+	[0x0F] = 3 | IDLE_BRANCH,	// BBR0 $ZZ,$rr
+	[0x10] = 2 | IDLE_BRANCH,	// BPL REL
+	[0x15] = 2 | IDLE_REG,		// ORA $ZZ,X
+	[0x18] = 1 | IDLE_REG,		// CLC
+	[0x19] = 3 | IDLE_ABSX,		// ORA $hhll,Y
+	[0x1A] = 1 | IDLE_REG,		// INC A
+	[0x1D] = 3 | IDLE_ABSX,		// ORA $hhll,X
+	[0x1F] = 3 | IDLE_BRANCH,	// BBR1 $ZZ,$rr
+	[0x22] = 1 | IDLE_REG,		// SAX
+	[0x24] = 2 | IDLE_REG,		// BIT $ZZ
+	[0x25] = 2 | IDLE_REG,		// AND $ZZ
+	[0x29] = 2 | IDLE_REG,		// AND #$nn
+	[0x2A] = 1 | IDLE_REG,		// ROL A
+	[0x2C] = 3 | IDLE_ABS,		// BIT $hhll
+	[0x2D] = 3 | IDLE_ABS,		// AND $hhll
+	[0x2F] = 3 | IDLE_BRANCH,	// BBR2 $ZZ,$rr
+	[0x30] = 2 | IDLE_BRANCH,	// BMI $rr
+	[0x34] = 2 | IDLE_REG,		// BIT $ZZ,X
+	[0x35] = 2 | IDLE_REG,		// AND $ZZ,X
+	[0x38] = 1 | IDLE_REG,		// SEC
+	[0x39] = 3 | IDLE_ABSX,		// AND $hhll,Y
+	[0x3A] = 1 | IDLE_REG,		// DEC A
+	[0x3C] = 3 | IDLE_ABSX,		// BIT $hhll,X
+	[0x3D] = 3 | IDLE_ABSX,		// AND $hhll,X
+	[0x3F] = 3 | IDLE_BRANCH,	// BBR3 $ZZ,$rr
+	[0x42] = 1 | IDLE_REG,		// SAY
+	[0x45] = 2 | IDLE_REG,		// EOR $ZZ
+	[0x49] = 2 | IDLE_REG,		// EOR #$nn
+	[0x4A] = 1 | IDLE_REG,		// LSR A
+	[0x4D] = 3 | IDLE_ABS,		// EOR $hhll
+	[0x4F] = 3 | IDLE_BRANCH,	// BBR4 $ZZ,$rr
+	[0x50] = 2 | IDLE_BRANCH,	// BVC $rr
+	[0x55] = 2 | IDLE_REG,		// EOR $ZZ,X
+	[0x59] = 3 | IDLE_ABSX,		// EOR $hhll,Y
+	[0x5D] = 3 | IDLE_ABSX,		// EOR $hhll,X
+	[0x5F] = 3 | IDLE_BRANCH,	// BBR5 $ZZ,$rr
+	[0x62] = 1 | IDLE_REG,		// CLA
+	[0x65] = 2 | IDLE_REG,		// ADC $ZZ
+	[0x69] = 2 | IDLE_REG,		// ADC #$nn
+	[0x6A] = 1 | IDLE_REG,		// ROR A
+	[0x6D] = 3 | IDLE_ABS,		// ADC $hhll
+	[0x6F] = 3 | IDLE_BRANCH,	// BBR6 $ZZ,$rr
+	[0x70] = 2 | IDLE_BRANCH,	// BVS $rr
+	[0x75] = 2 | IDLE_REG,		// ADC $ZZ,X
+	[0x79] = 3 | IDLE_ABSX,		// ADC $hhll,Y
+	[0x7D] = 3 | IDLE_ABSX,		// ADC $hhll,X
+	[0x7F] = 3 | IDLE_BRANCH,	// BBR7 $ZZ,$rr
+	[0x80] = 2 | IDLE_BRANCH,	// BRA $rr
+	[0x82] = 1 | IDLE_REG,		// CLX
+	[0x83] = 3 | IDLE_REG,		// TST #$nn,$ZZ
+	[0x88] = 1 | IDLE_REG,		// DEY
+	[0x89] = 2 | IDLE_REG,		// BIT #$nn
+	[0x8A] = 1 | IDLE_REG,		// TXA
+	[0x8F] = 3 | IDLE_BRANCH,	// BBS0 $ZZ,$rr
+	[0x90] = 2 | IDLE_BRANCH,	// BCC $rr
+	[0x93] = 4 | IDLE_ABS,		// TST #$nn,$hhll
+	[0x98] = 1 | IDLE_REG,		// TYA
+	[0x9F] = 3 | IDLE_BRANCH,	// BBS1 $ZZ,$rr
+	[0xA0] = 2 | IDLE_REG,		// LDY #$nn
+	[0xA2] = 2 | IDLE_REG,		// LDX #$nn
+	[0xA3] = 3 | IDLE_REG,		// TST #$nn,$ZZ,X
+	[0xA4] = 2 | IDLE_REG,		// LDY $ZZ
+	[0xA5] = 2 | IDLE_REG,		// LDA $ZZ
+	[0xA6] = 2 | IDLE_REG,		// LDX $ZZ
+	[0xA8] = 1 | IDLE_REG,		// TAY
+	[0xA9] = 2 | IDLE_REG,		// LDA #$nn
+	[0xAA] = 1 | IDLE_REG,		// TAX
+	[0xAC] = 3 | IDLE_ABS,		// LDY $hhll
+	[0xAD] = 3 | IDLE_ABS,		// LDA $hhll
+	[0xAE] = 3 | IDLE_ABS,		// LDX $hhll
+	[0xAF] = 3 | IDLE_BRANCH,	// BBS2 $ZZ,$rr
+	[0xB0] = 2 | IDLE_BRANCH,	// BCS $rr
+	[0xB3] = 4 | IDLE_ABSX,		// TST #$nn,$hhll,X
+	[0xB4] = 2 | IDLE_REG,		// LDY $ZZ,X
+	[0xB5] = 2 | IDLE_REG,		// LDA $ZZ,X
+	[0xB6] = 2 | IDLE_REG,		// LDX $ZZ,Y
+	[0xB8] = 1 | IDLE_REG,		// CLV
+	[0xB9] = 3 | IDLE_ABSX,		// LDA $hhll,Y
+	[0xBA] = 1 | IDLE_REG,		// TSX
+	[0xBC] = 3 | IDLE_ABSX,		// LDY $hhll,X
+	[0xBD] = 3 | IDLE_ABSX,		// LDA $hhll,X
+	[0xBE] = 3 | IDLE_ABSX,		// LDX $hhll,Y
+	[0xBF] = 3 | IDLE_BRANCH,	// BBS3 $ZZ,$rr
+	[0xC0] = 2 | IDLE_REG,		// CPY #$nn
+	[0xC2] = 1 | IDLE_REG,		// CLY
+	[0xC4] = 2 | IDLE_REG,		// CPY $ZZ
+	[0xC5] = 2 | IDLE_REG,		// CMP $ZZ
+	[0xC8] = 1 | IDLE_REG,		// INY
+	[0xC9] = 2 | IDLE_REG,		// CMP #$nn
+	[0xCA] = 1 | IDLE_REG,		// DEX
+	[0xCC] = 3 | IDLE_ABS,		// CPY $hhll
+	[0xCD] = 3 | IDLE_ABS,		// CMP $hhll
+	[0xCF] = 3 | IDLE_BRANCH,	// BBS4 $ZZ,$rr
+	[0xD0] = 2 | IDLE_BRANCH,	// BNE $rr
+	[0xD5] = 2 | IDLE_REG,		// CMP $ZZ,X
+	[0xD8] = 1 | IDLE_REG,		// CLD
+	[0xD9] = 3 | IDLE_ABSX,		// CMP $hhll,Y
+	[0xDD] = 3 | IDLE_ABSX,		// CMP $hhll,X
+	[0xDF] = 3 | IDLE_BRANCH,	// BBS5 $ZZ,$rr
+	[0xE0] = 2 | IDLE_REG,		// CPX #$nn
+	[0xE4] = 2 | IDLE_REG,		// CPX $ZZ
+	[0xE5] = 2 | IDLE_REG,		// SBC $ZZ
+	[0xE8] = 1 | IDLE_REG,		// INX
+	[0xE9] = 2 | IDLE_REG,		// SBC #$nn
+	[0xEA] = 1 | IDLE_REG,		// NOP
+	[0xEC] = 3 | IDLE_ABS,		// CPX $hhll
+	[0xED] = 3 | IDLE_ABS,		// SBC $hhll
+	[0xEF] = 3 | IDLE_BRANCH,	// BBS6 $ZZ,$rr
+	[0xF0] = 2 | IDLE_BRANCH,	// BEQ $rr
+	[0xF5] = 2 | IDLE_REG,		// SBC $ZZ,X
+	[0xF8] = 1 | IDLE_REG,		// SED
+	[0xF9] = 3 | IDLE_ABSX,		// SBC $hhll,Y
+	[0xFD] = 3 | IDLE_ABSX,		// SBC $hhll,X
+	[0xFF] = 3 | IDLE_BRANCH,	// BBS7 $ZZ,$rr
+};
+
+static struct {
+	uint8_t *page;		/* bank containing the loop, NULL at slice start */
+	uint16_t branch;	/* address of the backward branch */
+	uint16_t unsafe;	/* body has side effects, don't analyze it again */
+	uint32_t state;		/* A, X, Y, P at the previous iteration */
+	int32_t cycles;		/* Cycles at the previous iteration */
+} idle;
+
+// IO registers that can be polled by an idle loop: 1 if reading has no side
+// effects, 2 if reading clears it (VDC status, IRQ status), 0 otherwise
+static inline int
+idle_io_read(uint16_t addr)
+{
+	if (pce_handlerR(addr) != MAP_IO)
+		return 0;
+
+	switch (addr & 0x1F00) {
+	case 0x0000: return (addr & 3) == 0 ? 2 : 0;	/* VDC status */
+	case 0x0C00: return 1;							/* Timer */
+	case 0x1400: return (addr & 3) == 2 ? 1 : (addr & 3) == 3 ? 2 : 0;
+	}
+	return 0;
+}
+
+// Check that the loop body only reads memory. Branches in the body must stay
+// in it, a path through code outside could write. A register cleared by
+// reading it is only stable if the loop reads it on every iteration (no
+// branch in the body).
+static bool
+idle_loop_safe(uint16_t pc, uint16_t branch)
+{
+	uint8_t *page = PageR[pc >> 13];
+	uint16_t top = pc, to;
+	bool branches = false, clears = false;
+
+	if (!page || branch - pc > IDLE_LOOP_MAX_SIZE || (pc >> 13) != (branch >> 13))
+		return false;
+
+	while (pc < branch) {
+		uint8_t type = idle_ops[page[pc]];
+		uint8_t len = type & 15;
+		uint16_t addr;
+
+		switch (type & 0xF0) {
+		case IDLE_REG:
+			break;
+		case IDLE_BRANCH:
+			to = pc + len + (int8_t)page[pc + len - 1];
+			if (to < top || to > branch)
+				return false;
+			branches = true;
+			break;
+		case IDLE_ABS:
+			addr = page[pc + len - 2] | page[pc + len - 1] << 8;
+			if (!PageR[addr >> 13]) {
+				int io = idle_io_read(addr);
+				if (!io)
+					return false;
+				clears |= (io == 2);
+			}
+			break;
+		case IDLE_ABSX:
+			addr = page[pc + len - 2] | page[pc + len - 1] << 8;
+			if (!PageR[addr >> 13] || !PageR[(uint16_t)(addr + 0xFF) >> 13])
+				return false;
+			break;
+		default:
+			return false;
+		}
+		pc += len;
+	}
+
+	return pc == branch && !(branches && clears);
+}
+
+// Called on every taken backward branch, returns the number of cycles to skip
+static __attribute__((noinline)) int32_t
+idle_loop(uint16_t branch, uint16_t target, uint32_t state, int32_t cycles, int32_t max_cycles)
 {
-	CPU.P &= ~FL_T;
-	if (zp_operand(CPU.PC + 1) & (1 << bit))
+	uint8_t *page = PageR[branch >> 13];
+
+	if (branch != idle.branch || page != idle.page) {
+		idle.branch = branch;
+		idle.page = page;
+		idle.unsafe = 0;
+		idle.state = state;
+		idle.cycles = cycles;
+		return 0;
+	}
+
+	int32_t period = cycles - idle.cycles;
+	bool same = (state == idle.state);
+
+	idle.state = state;
+	idle.cycles = cycles;
+
+	if (!same || period <= 0 || idle.unsafe)
+		return 0;
+
+	if (!idle_loop_safe(target, branch)) {
+		idle.unsafe = 1;
+		return 0;
+	}
+
+	int32_t skip = (max_cycles - cycles) / period * period;
+	if (skip > 0) {
+		idle.cycles += skip;
+		PCE.IdleCycles += skip;
+	}
+	return skip;
+}
+
+#define chk_idle_loop(from) {										\
+	if (cpu->PC <= (from) && PCE.IdleSkip) {							\
+		uint32_t state = cpu->A | cpu->X << 8 | cpu->Y << 16 | (uint32_t)get_flags(cpu) << 24; \
+		cpu->cycles += idle_loop((from), cpu->PC, state, cpu->cycles, cpu->max_cycles); \
+	}																\
+}
+#else
+#define chk_idle_loop(from) {}
+#endif
+
+// Taken relative branch, the offset is the last byte of the instruction
+#define branch_taken(len, cyc) {									\
+	UWORD from = cpu->PC;											\
+	cpu->PC += (SBYTE)insn8((len) - 1) + (len);				\
+	cpu->cycles += (cyc);											\
+	chk_idle_loop(from);											\
+}
+
+OPCODE_FUNC bbr(h6280_regs_t *cpu, UBYTE bit)
+{
+	cpu->P &= ~FL_T;
+	if (zp_operand(1) & (1 << bit))
 	{
-		CPU.PC += 3;
-		Cycles += 6;
+		cpu->PC += 3;
+		cpu->cycles += 6;
 	}
 	else
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 2) + 3;
-		Cycles += 8;
+		branch_taken(3, 8);
 	}
 }
 
-OPCODE_FUNC bbs(UBYTE bit)
+OPCODE_FUNC bbs(h6280_regs_t *cpu, UBYTE bit)
 {
-	CPU.P &= ~FL_T;
-	if (zp_operand(CPU.PC + 1) & (1 << bit))
+	cpu->P &= ~FL_T;
+	if (zp_operand(1) & (1 << bit))
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 2) + 3;
-		Cycles += 8;
+		branch_taken(3, 8);
 	}
 	else
 	{
-		CPU.PC += 3;
-		Cycles += 6;
+		cpu->PC += 3;
+		cpu->cycles += 6;
 	}
 }
 
-OPCODE_FUNC bcc(void)
+OPCODE_FUNC bcc(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_C)
+	cpu->P &= ~FL_T;
+	if (cpu->P & FL_C)
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 	else
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 }
 
-OPCODE_FUNC bcs(void)
+OPCODE_FUNC bcs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_C)
+	cpu->P &= ~FL_T;
+	if (cpu->P & FL_C)
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 	else
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 }
 
-OPCODE_FUNC beq(void)
+OPCODE_FUNC beq(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_Z)
+	cpu->P &= ~FL_T;
+	if (flag_z())
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 	else
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 }
 
-OPCODE_FUNC bit_abs(void)
+OPCODE_FUNC bit_abs(h6280_regs_t *cpu)
 {
-	UBYTE temp = abs_operand(CPU.PC + 1);
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((CPU.A & temp) ? 0 : FL_Z);
-	CPU.PC += 3;
-	Cycles += 5;
+	UBYTE temp = abs_operand(1);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, cpu->A & temp);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC bit_absx(void)
+OPCODE_FUNC bit_absx(h6280_regs_t *cpu)
 {
-	UBYTE temp = absx_operand(CPU.PC + 1);
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((CPU.A & temp) ? 0 : FL_Z);
-	CPU.PC += 3;
-	Cycles += 5;
+	UBYTE temp = absx_operand(1);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, cpu->A & temp);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC bit_imm(void)
+OPCODE_FUNC bit_imm(h6280_regs_t *cpu)
 {
-	UBYTE temp = imm_operand(CPU.PC + 1);
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((CPU.A & temp) ? 0 : FL_Z);
-	CPU.PC += 2;
-	Cycles += 2;
+	UBYTE temp = insn8(1);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, cpu->A & temp);
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC bit_zp(void)
+OPCODE_FUNC bit_zp(h6280_regs_t *cpu)
 {
-	UBYTE temp = zp_operand(CPU.PC + 1);
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((CPU.A & temp) ? 0 : FL_Z);
-	CPU.PC += 2;
-	Cycles += 4;
+	UBYTE temp = zp_operand(1);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, cpu->A & temp);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC bit_zpx(void)
+OPCODE_FUNC bit_zpx(h6280_regs_t *cpu)
 {
-	UBYTE temp = zpx_operand(CPU.PC + 1);
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((CPU.A & temp) ? 0 : FL_Z);
-	CPU.PC += 2;
-	Cycles += 4;
+	UBYTE temp = zpx_operand(1);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, cpu->A & temp);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC bmi(void)
+OPCODE_FUNC bmi(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_N)
+	cpu->P &= ~FL_T;
+	if (flag_n())
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 	else
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 }
 
-OPCODE_FUNC bne(void)
+OPCODE_FUNC bne(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_Z)
+	cpu->P &= ~FL_T;
+	if (flag_z())
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 	else
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 }
 
-OPCODE_FUNC bpl(void)
+OPCODE_FUNC bpl(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_N)
+	cpu->P &= ~FL_T;
+	if (flag_n())
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 	else
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 }
 
-OPCODE_FUNC bra(void)
+OPCODE_FUNC bra(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	branch_taken(2, 4);
 }
 
-OPCODE_FUNC brk(void)
+OPCODE_FUNC brk(h6280_regs_t *cpu)
 {
-	MESSAGE_DEBUG("BRK opcode has been hit [PC = 0x%04x] at %s(%d)\n", CPU.PC);
-	CPU.P &= ~FL_T;
-	push_16bit(CPU.PC + 2);
-	push_8bit(CPU.P | FL_B);
-	CPU.P = (CPU.P & ~FL_D) | FL_I;
-	CPU.PC = pce_read16(VEC_BRK);
-	Cycles += 8;
+	MESSAGE_DEBUG("BRK opcode has been hit [PC = 0x%04x] at %s(%d)\n", cpu->PC);
+	cpu->P &= ~FL_T;
+	push_16bit(cpu->PC + 2);
+	push_8bit(get_flags(cpu) | FL_B);
+	cpu->P = (cpu->P & ~FL_D) | FL_I;
+	cpu->PC = pce_read16(VEC_BRK);
+	cpu->cycles += 8;
 }
 
-OPCODE_FUNC bsr(void)
+OPCODE_FUNC bsr(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	push_16bit(CPU.PC + 1);
-	CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-	Cycles += 8;
+	cpu->P &= ~FL_T;
+	push_16bit(cpu->PC + 1);
+	cpu->PC += (SBYTE)insn8(1) + 2;
+	cpu->cycles += 8;
 }
 
-OPCODE_FUNC bvc(void)
+OPCODE_FUNC bvc(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_V)
+	cpu->P &= ~FL_T;
+	if (cpu->P & FL_V)
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 	else
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 }
 
-OPCODE_FUNC bvs(void)
+OPCODE_FUNC bvs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	if (CPU.P & FL_V)
+	cpu->P &= ~FL_T;
+	if (cpu->P & FL_V)
 	{
-		CPU.PC += (SBYTE)imm_operand(CPU.PC + 1) + 2;
-		Cycles += 4;
+		branch_taken(2, 4);
 	}
 	else
 	{
-		CPU.PC += 2;
-		Cycles += 2;
+		cpu->PC += 2;
+		cpu->cycles += 2;
 	}
 }
 
-OPCODE_FUNC cla(void)
+OPCODE_FUNC cla(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.A = 0;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~FL_T;
+	cpu->A = 0;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC clc(void)
+OPCODE_FUNC clc(h6280_regs_t *cpu)
 {
-	CPU.P &= ~(FL_T | FL_C);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~(FL_T | FL_C);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cld(void)
+OPCODE_FUNC cld(h6280_regs_t *cpu)
 {
-	CPU.P &= ~(FL_T | FL_D);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~(FL_T | FL_D);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cli(void)
+OPCODE_FUNC cli(h6280_regs_t *cpu)
 {
-	CPU.P &= ~(FL_T | FL_I);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~(FL_T | FL_I);
+	cpu->PC++;
+	cpu->cycles += 2;
+	chk_irq_pending();
 }
 
-OPCODE_FUNC clv(void)
+OPCODE_FUNC clv(h6280_regs_t *cpu)
 {
-	CPU.P &= ~(FL_V | FL_T);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~(FL_V | FL_T);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC clx(void)
+OPCODE_FUNC clx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.X = 0;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~FL_T;
+	cpu->X = 0;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cly(void)
+OPCODE_FUNC cly(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.Y = 0;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~FL_T;
+	cpu->Y = 0;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cmp_abs(void)
+OPCODE_FUNC cmp_abs(h6280_regs_t *cpu)
 {
-	UBYTE temp = abs_operand(CPU.PC + 1);
+	UBYTE temp = abs_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC cmp_absx(void)
+OPCODE_FUNC cmp_absx(h6280_regs_t *cpu)
 {
-	UBYTE temp = absx_operand(CPU.PC + 1);
+	UBYTE temp = absx_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC cmp_absy(void)
+OPCODE_FUNC cmp_absy(h6280_regs_t *cpu)
 {
-	UBYTE temp = absy_operand(CPU.PC + 1);
+	UBYTE temp = absy_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC cmp_imm(void)
+OPCODE_FUNC cmp_imm(h6280_regs_t *cpu)
 {
-	UBYTE temp = imm_operand(CPU.PC + 1);
+	UBYTE temp = insn8(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 2;
-	Cycles += 2;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cmp_zp(void)
+OPCODE_FUNC cmp_zp(h6280_regs_t *cpu)
 {
-	UBYTE temp = zp_operand(CPU.PC + 1);
+	UBYTE temp = zp_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC cmp_zpx(void)
+OPCODE_FUNC cmp_zpx(h6280_regs_t *cpu)
 {
-	UBYTE temp = zpx_operand(CPU.PC + 1);
+	UBYTE temp = zpx_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC cmp_zpind(void)
+OPCODE_FUNC cmp_zpind(h6280_regs_t *cpu)
 {
-	UBYTE temp = zpind_operand(CPU.PC + 1);
+	UBYTE temp = zpind_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC cmp_zpindx(void)
+OPCODE_FUNC cmp_zpindx(h6280_regs_t *cpu)
 {
-	UBYTE temp = zpindx_operand(CPU.PC + 1);
+	UBYTE temp = zpindx_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC cmp_zpindy(void)
+OPCODE_FUNC cmp_zpindy(h6280_regs_t *cpu)
 {
-	UBYTE temp = zpindy_operand(CPU.PC + 1);
+	UBYTE temp = zpindy_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.A < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.A - temp));
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->A < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->A - temp));
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC cpx_abs(void)
+OPCODE_FUNC cpx_abs(h6280_regs_t *cpu)
 {
-	UBYTE temp = abs_operand(CPU.PC + 1);
+	UBYTE temp = abs_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.X < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.X - temp));
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->X < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->X - temp));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC cpx_imm(void)
+OPCODE_FUNC cpx_imm(h6280_regs_t *cpu)
 {
-	UBYTE temp = imm_operand(CPU.PC + 1);
+	UBYTE temp = insn8(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.X < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.X - temp));
-	CPU.PC += 2;
-	Cycles += 2;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->X < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->X - temp));
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cpx_zp(void)
+OPCODE_FUNC cpx_zp(h6280_regs_t *cpu)
 {
-	UBYTE temp = zp_operand(CPU.PC + 1);
+	UBYTE temp = zp_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.X < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.X - temp));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->X < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->X - temp));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC cpy_abs(void)
+OPCODE_FUNC cpy_abs(h6280_regs_t *cpu)
 {
-	UBYTE temp = abs_operand(CPU.PC + 1);
+	UBYTE temp = abs_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.Y < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.Y - temp));
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->Y < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->Y - temp));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC cpy_imm(void)
+OPCODE_FUNC cpy_imm(h6280_regs_t *cpu)
 {
-	UBYTE temp = imm_operand(CPU.PC + 1);
+	UBYTE temp = insn8(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.Y < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.Y - temp));
-	CPU.PC += 2;
-	Cycles += 2;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->Y < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->Y - temp));
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC cpy_zp(void)
+OPCODE_FUNC cpy_zp(h6280_regs_t *cpu)
 {
-	UBYTE temp = zp_operand(CPU.PC + 1);
+	UBYTE temp = zp_operand(1);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((CPU.Y < temp) ? 0 : FL_C) | FLAG_NZ((UBYTE)(CPU.Y - temp));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((cpu->Y < temp) ? 0 : FL_C);
+	set_nz((UBYTE)(cpu->Y - temp));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC dec_a(void)
+OPCODE_FUNC dec_a(h6280_regs_t *cpu)
 {
-	--CPU.A;
-	chk_flnz_8bit(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	--cpu->A;
+	chk_flnz_8bit(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC dec_abs(void)
+OPCODE_FUNC dec_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp = pce_read8(temp_addr) - 1;
+	UWORD temp_addr = insn16(1);
+	UBYTE temp = cpu_read8(temp_addr) - 1;
 	chk_flnz_8bit(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC dec_absx(void)
+OPCODE_FUNC dec_absx(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1) + CPU.X;
-	UBYTE temp = pce_read8(temp_addr) - 1;
+	UWORD temp_addr = insn16(1) + cpu->X;
+	UBYTE temp = cpu_read8(temp_addr) - 1;
 	chk_flnz_8bit(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC dec_zp(void)
+OPCODE_FUNC dec_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp = get_8bit_zp(zp_addr) - 1;
 	chk_flnz_8bit(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC dec_zpx(void)
+OPCODE_FUNC dec_zpx(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1) + CPU.X;
+	UBYTE zp_addr = insn8(1) + cpu->X;
 	UBYTE temp = get_8bit_zp(zp_addr) - 1;
 	chk_flnz_8bit(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC dex(void)
+OPCODE_FUNC dex(h6280_regs_t *cpu)
 {
-	--CPU.X;
-	chk_flnz_8bit(CPU.X);
-	CPU.PC++;
-	Cycles += 2;
+	--cpu->X;
+	chk_flnz_8bit(cpu->X);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC dey(void)
+OPCODE_FUNC dey(h6280_regs_t *cpu)
 {
-	--CPU.Y;
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC++;
-	Cycles += 2;
+	--cpu->Y;
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC eor_abs(void)
+OPCODE_FUNC eor_abs(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= abs_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= abs_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A ^= abs_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A ^= abs_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC eor_absx(void)
+OPCODE_FUNC eor_absx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= absx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= absx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A ^= absx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A ^= absx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC eor_absy(void)
+OPCODE_FUNC eor_absy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= absy_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= absy_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A ^= absy_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A ^= absy_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC eor_imm(void)
+OPCODE_FUNC eor_imm(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= imm_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= insn8(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 5;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 5;
 	}
 	else
 	{
-		CPU.A ^= imm_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 2;
+		cpu->A ^= insn8(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 2;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC eor_zp(void)
+OPCODE_FUNC eor_zp(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= zp_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= zp_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 7;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A ^= zp_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 4;
+		cpu->A ^= zp_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC eor_zpx(void)
+OPCODE_FUNC eor_zpx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= zpx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= zpx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 7;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A ^= zpx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 4;
+		cpu->A ^= zpx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC eor_zpind(void)
+OPCODE_FUNC eor_zpind(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= zpind_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= zpind_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A ^= zpind_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A ^= zpind_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC eor_zpindx(void)
+OPCODE_FUNC eor_zpindx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= zpindx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= zpindx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A ^= zpindx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A ^= zpindx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC eor_zpindy(void)
+OPCODE_FUNC eor_zpindy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp ^= zpindy_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp ^= zpindy_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A ^= zpindy_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A ^= zpindy_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC halt(void)
+OPCODE_FUNC halt(h6280_regs_t *cpu)
 {
 	return;
 }
 
-OPCODE_FUNC inc_a(void)
+OPCODE_FUNC inc_a(h6280_regs_t *cpu)
 {
-	++CPU.A;
-	chk_flnz_8bit(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	++cpu->A;
+	chk_flnz_8bit(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC inc_abs(void)
+OPCODE_FUNC inc_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp = pce_read8(temp_addr) + 1;
+	UWORD temp_addr = insn16(1);
+	UBYTE temp = cpu_read8(temp_addr) + 1;
 	chk_flnz_8bit(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC inc_absx(void)
+OPCODE_FUNC inc_absx(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1) + CPU.X;
-	UBYTE temp = pce_read8(temp_addr) + 1;
+	UWORD temp_addr = insn16(1) + cpu->X;
+	UBYTE temp = cpu_read8(temp_addr) + 1;
 	chk_flnz_8bit(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC inc_zp(void)
+OPCODE_FUNC inc_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp = get_8bit_zp(zp_addr) + 1;
 	chk_flnz_8bit(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC inc_zpx(void)
+OPCODE_FUNC inc_zpx(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1) + CPU.X;
+	UBYTE zp_addr = insn8(1) + cpu->X;
 	UBYTE temp = get_8bit_zp(zp_addr) + 1;
 	chk_flnz_8bit(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC inx(void)
+OPCODE_FUNC inx(h6280_regs_t *cpu)
 {
-	++CPU.X;
-	chk_flnz_8bit(CPU.X);
-	CPU.PC++;
-	Cycles += 2;
+	++cpu->X;
+	chk_flnz_8bit(cpu->X);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC iny(void)
+OPCODE_FUNC iny(h6280_regs_t *cpu)
 {
-	++CPU.Y;
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC++;
-	Cycles += 2;
+	++cpu->Y;
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC jmp(void)
+OPCODE_FUNC jmp(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.PC = pce_read16(CPU.PC + 1);
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	cpu->PC = insn16(1);
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC jmp_absind(void)
+OPCODE_FUNC jmp_absind(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.PC = pce_read16(pce_read16(CPU.PC + 1));
-	Cycles += 7;
+	cpu->P &= ~FL_T;
+	cpu->PC = pce_read16(insn16(1));
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC jmp_absindx(void)
+OPCODE_FUNC jmp_absindx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.PC = pce_read16(pce_read16(CPU.PC + 1) + CPU.X);
-	Cycles += 7;
+	cpu->P &= ~FL_T;
+	cpu->PC = pce_read16(insn16(1) + cpu->X);
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC jsr(void)
+OPCODE_FUNC jsr(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	push_16bit(CPU.PC + 2);
-	CPU.PC = pce_read16(CPU.PC + 1);
-	Cycles += 7;
+	cpu->P &= ~FL_T;
+	push_16bit(cpu->PC + 2);
+	cpu->PC = insn16(1);
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC lda_abs(void)
+OPCODE_FUNC lda_abs(h6280_regs_t *cpu)
 {
-	CPU.A = abs_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->A = abs_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC lda_absx(void)
+OPCODE_FUNC lda_absx(h6280_regs_t *cpu)
 {
-	CPU.A = absx_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->A = absx_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC lda_absy(void)
+OPCODE_FUNC lda_absy(h6280_regs_t *cpu)
 {
-	CPU.A = absy_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->A = absy_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC lda_imm(void)
+OPCODE_FUNC lda_imm(h6280_regs_t *cpu)
 {
-	CPU.A = imm_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 2;
-	Cycles += 2;
+	cpu->A = insn8(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC lda_zp(void)
+OPCODE_FUNC lda_zp(h6280_regs_t *cpu)
 {
-	CPU.A = zp_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->A = zp_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC lda_zpx(void)
+OPCODE_FUNC lda_zpx(h6280_regs_t *cpu)
 {
-	CPU.A = zpx_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->A = zpx_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC lda_zpind(void)
+OPCODE_FUNC lda_zpind(h6280_regs_t *cpu)
 {
-	CPU.A = zpind_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->A = zpind_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC lda_zpindx(void)
+OPCODE_FUNC lda_zpindx(h6280_regs_t *cpu)
 {
-	CPU.A = zpindx_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->A = zpindx_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC lda_zpindy(void)
+OPCODE_FUNC lda_zpindy(h6280_regs_t *cpu)
 {
-	CPU.A = zpindy_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->A = zpindy_operand(1);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC ldx_abs(void)
+OPCODE_FUNC ldx_abs(h6280_regs_t *cpu)
 {
-	CPU.X = abs_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.X);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->X = abs_operand(1);
+	chk_flnz_8bit(cpu->X);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC ldx_absy(void)
+OPCODE_FUNC ldx_absy(h6280_regs_t *cpu)
 {
-	CPU.X = absy_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.X);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->X = absy_operand(1);
+	chk_flnz_8bit(cpu->X);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC ldx_imm(void)
+OPCODE_FUNC ldx_imm(h6280_regs_t *cpu)
 {
-	CPU.X = imm_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.X);
-	CPU.PC += 2;
-	Cycles += 2;
+	cpu->X = insn8(1);
+	chk_flnz_8bit(cpu->X);
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC ldx_zp(void)
+OPCODE_FUNC ldx_zp(h6280_regs_t *cpu)
 {
-	CPU.X = zp_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.X);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->X = zp_operand(1);
+	chk_flnz_8bit(cpu->X);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC ldx_zpy(void)
+OPCODE_FUNC ldx_zpy(h6280_regs_t *cpu)
 {
-	CPU.X = zpy_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.X);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->X = zpy_operand(1);
+	chk_flnz_8bit(cpu->X);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC ldy_abs(void)
+OPCODE_FUNC ldy_abs(h6280_regs_t *cpu)
 {
-	CPU.Y = abs_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->Y = abs_operand(1);
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC ldy_absx(void)
+OPCODE_FUNC ldy_absx(h6280_regs_t *cpu)
 {
-	CPU.Y = absx_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->Y = absx_operand(1);
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC ldy_imm(void)
+OPCODE_FUNC ldy_imm(h6280_regs_t *cpu)
 {
-	CPU.Y = imm_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC += 2;
-	Cycles += 2;
+	cpu->Y = insn8(1);
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC ldy_zp(void)
+OPCODE_FUNC ldy_zp(h6280_regs_t *cpu)
 {
-	CPU.Y = zp_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->Y = zp_operand(1);
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC ldy_zpx(void)
+OPCODE_FUNC ldy_zpx(h6280_regs_t *cpu)
 {
-	CPU.Y = zpx_operand(CPU.PC + 1);
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->Y = zpx_operand(1);
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC lsr_a(void)
+OPCODE_FUNC lsr_a(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.A;
-	CPU.A /= 2;
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp & 1) ? FL_C : 0) | FLAG_NZ(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	UBYTE temp = cpu->A;
+	cpu->A /= 2;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp & 1) ? FL_C : 0);
+	set_nz(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC lsr_abs(void)
+OPCODE_FUNC lsr_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp1 = pce_read8(temp_addr);
+	UWORD temp_addr = insn16(1);
+	UBYTE temp1 = cpu_read8(temp_addr);
 	UBYTE temp = temp1 / 2;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 1) ? FL_C : 0) | FLAG_NZ(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 1) ? FL_C : 0);
+	set_nz(temp);
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC lsr_absx(void)
+OPCODE_FUNC lsr_absx(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1) + CPU.X;
-	UBYTE temp1 = pce_read8(temp_addr);
+	UWORD temp_addr = insn16(1) + cpu->X;
+	UBYTE temp1 = cpu_read8(temp_addr);
 	UBYTE temp = temp1 / 2;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 1) ? FL_C : 0) | FLAG_NZ(temp);
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 1) ? FL_C : 0);
+	set_nz(temp);
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC lsr_zp(void)
+OPCODE_FUNC lsr_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp1 = get_8bit_zp(zp_addr);
 	UBYTE temp = temp1 / 2;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 1) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 1) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC lsr_zpx(void)
+OPCODE_FUNC lsr_zpx(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1) + CPU.X;
+	UBYTE zp_addr = insn8(1) + cpu->X;
 	UBYTE temp1 = get_8bit_zp(zp_addr);
 	UBYTE temp = temp1 / 2;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 1) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 1) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC nop(void)
+OPCODE_FUNC nop(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~FL_T;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC ora_abs(void)
+OPCODE_FUNC ora_abs(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= abs_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= abs_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A |= abs_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A |= abs_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC ora_absx(void)
+OPCODE_FUNC ora_absx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= absx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= absx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A |= absx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A |= absx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC ora_absy(void)
+OPCODE_FUNC ora_absy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= absy_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= absy_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 8;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 8;
 	}
 	else
 	{
-		CPU.A |= absy_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 5;
+		cpu->A |= absy_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 5;
 	}
-	CPU.PC += 3;
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC ora_imm(void)
+OPCODE_FUNC ora_imm(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= imm_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= insn8(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 5;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 5;
 	}
 	else
 	{
-		CPU.A |= imm_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 2;
+		cpu->A |= insn8(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 2;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC ora_zp(void)
+OPCODE_FUNC ora_zp(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= zp_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= zp_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 7;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A |= zp_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 4;
+		cpu->A |= zp_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC ora_zpx(void)
+OPCODE_FUNC ora_zpx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= zpx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= zpx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 7;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 7;
 	}
 	else
 	{
-		CPU.A |= zpx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 4;
+		cpu->A |= zpx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 4;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC ora_zpind(void)
+OPCODE_FUNC ora_zpind(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= zpind_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= zpind_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A |= zpind_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A |= zpind_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC ora_zpindx(void)
+OPCODE_FUNC ora_zpindx(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= zpindx_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= zpindx_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A |= zpindx_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A |= zpindx_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC ora_zpindy(void)
+OPCODE_FUNC ora_zpindy(h6280_regs_t *cpu)
 {
-	if (CPU.P & FL_T)
+	if (cpu->P & FL_T)
 	{
-		UBYTE temp = get_8bit_zp(CPU.X);
-		temp |= zpindy_operand(CPU.PC + 1);
+		UBYTE temp = get_8bit_zp(cpu->X);
+		temp |= zpindy_operand(1);
 		chk_flnz_8bit(temp);
-		put_8bit_zp(CPU.X, temp);
-		Cycles += 10;
+		put_8bit_zp(cpu->X, temp);
+		cpu->cycles += 10;
 	}
 	else
 	{
-		CPU.A |= zpindy_operand(CPU.PC + 1);
-		chk_flnz_8bit(CPU.A);
-		Cycles += 7;
+		cpu->A |= zpindy_operand(1);
+		chk_flnz_8bit(cpu->A);
+		cpu->cycles += 7;
 	}
-	CPU.PC += 2;
+	cpu->PC += 2;
 }
 
-OPCODE_FUNC pha(void)
+OPCODE_FUNC pha(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	push_8bit(CPU.A);
-	CPU.PC++;
-	Cycles += 3;
+	cpu->P &= ~FL_T;
+	push_8bit(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC php(void)
+OPCODE_FUNC php(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	push_8bit(CPU.P);
-	CPU.PC++;
-	Cycles += 3;
+	cpu->P &= ~FL_T;
+	push_8bit(get_flags(cpu));
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC phx(void)
+OPCODE_FUNC phx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	push_8bit(CPU.X);
-	CPU.PC++;
-	Cycles += 3;
+	cpu->P &= ~FL_T;
+	push_8bit(cpu->X);
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC phy(void)
+OPCODE_FUNC phy(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	push_8bit(CPU.Y);
-	CPU.PC++;
-	Cycles += 3;
+	cpu->P &= ~FL_T;
+	push_8bit(cpu->Y);
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC pla(void)
+OPCODE_FUNC pla(h6280_regs_t *cpu)
 {
-	pull_8bit(CPU.A);
-	chk_flnz_8bit(CPU.A);
-	CPU.PC++;
-	Cycles += 4;
+	pull_8bit(cpu->A);
+	chk_flnz_8bit(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC plp(void)
+OPCODE_FUNC plp(h6280_regs_t *cpu)
 {
-	pull_8bit(CPU.P);
-	CPU.PC++;
-	Cycles += 4;
+	UBYTE temp;
+	pull_8bit(temp);
+	set_flags(cpu, temp);
+	cpu->PC++;
+	cpu->cycles += 4;
+	chk_irq_pending();
 }
 
-OPCODE_FUNC plx(void)
+OPCODE_FUNC plx(h6280_regs_t *cpu)
 {
-	pull_8bit(CPU.X);
-	chk_flnz_8bit(CPU.X);
-	CPU.PC++;
-	Cycles += 4;
+	pull_8bit(cpu->X);
+	chk_flnz_8bit(cpu->X);
+	cpu->PC++;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC ply(void)
+OPCODE_FUNC ply(h6280_regs_t *cpu)
 {
-	pull_8bit(CPU.Y);
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC++;
-	Cycles += 4;
+	pull_8bit(cpu->Y);
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC++;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC rmb(UBYTE bit)
+OPCODE_FUNC rmb(h6280_regs_t *cpu, UBYTE bit)
 {
-	UBYTE temp = imm_operand(CPU.PC + 1);
-	CPU.P &= ~FL_T;
+	UBYTE temp = insn8(1);
+	cpu->P &= ~FL_T;
 	put_8bit_zp(temp, get_8bit_zp(temp) & (~(1 << bit)));
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC rol_a(void)
+OPCODE_FUNC rol_a(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.A;
-	CPU.A = (CPU.A << 1) + (CPU.P & FL_C);
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp & 0x80) ? FL_C : 0) | FLAG_NZ(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	UBYTE temp = cpu->A;
+	cpu->A = (cpu->A << 1) + (cpu->P & FL_C);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp & 0x80) ? FL_C : 0);
+	set_nz(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC rol_abs(void)
+OPCODE_FUNC rol_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp1 = pce_read8(temp_addr);
-	UBYTE temp = (temp1 << 1) + (CPU.P & FL_C);
+	UWORD temp_addr = insn16(1);
+	UBYTE temp1 = cpu_read8(temp_addr);
+	UBYTE temp = (temp1 << 1) + (cpu->P & FL_C);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
-	Cycles += 7;
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
+	cpu->cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC rol_absx(void)
+OPCODE_FUNC rol_absx(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1) + CPU.X;
-	UBYTE temp1 = pce_read8(temp_addr);
-	UBYTE temp = (temp1 << 1) + (CPU.P & FL_C);
+	UWORD temp_addr = insn16(1) + cpu->X;
+	UBYTE temp1 = cpu_read8(temp_addr);
+	UBYTE temp = (temp1 << 1) + (cpu->P & FL_C);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
-	Cycles += 7;
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
+	cpu->cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC rol_zp(void)
+OPCODE_FUNC rol_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp1 = get_8bit_zp(zp_addr);
-	UBYTE temp = (temp1 << 1) + (CPU.P & FL_C);
+	UBYTE temp = (temp1 << 1) + (cpu->P & FL_C);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC rol_zpx(void)
+OPCODE_FUNC rol_zpx(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1) + CPU.X;
+	UBYTE zp_addr = insn8(1) + cpu->X;
 	UBYTE temp1 = get_8bit_zp(zp_addr);
-	UBYTE temp = (temp1 << 1) + (CPU.P & FL_C);
+	UBYTE temp = (temp1 << 1) + (cpu->P & FL_C);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x80) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x80) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC ror_a(void)
+OPCODE_FUNC ror_a(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.A;
-	CPU.A = (CPU.A >> 1) + ((CPU.P & FL_C) ? 0x80 : 0);
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp & 0x01) ? FL_C : 0) | FLAG_NZ(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	UBYTE temp = cpu->A;
+	cpu->A = (cpu->A >> 1) + ((cpu->P & FL_C) ? 0x80 : 0);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp & 0x01) ? FL_C : 0);
+	set_nz(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC ror_abs(void)
+OPCODE_FUNC ror_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp1 = pce_read8(temp_addr);
-	UBYTE temp = (temp1 >> 1) + ((CPU.P & FL_C) ? 0x80 : 0);
+	UWORD temp_addr = insn16(1);
+	UBYTE temp1 = cpu_read8(temp_addr);
+	UBYTE temp = (temp1 >> 1) + ((cpu->P & FL_C) ? 0x80 : 0);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x01) ? FL_C : 0) | FLAG_NZ(temp);
-	Cycles += 7;
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x01) ? FL_C : 0);
+	set_nz(temp);
+	cpu->cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC ror_absx(void)
+OPCODE_FUNC ror_absx(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1) + CPU.X;
-	UBYTE temp1 = pce_read8(temp_addr);
-	UBYTE temp = (temp1 >> 1) + ((CPU.P & FL_C) ? 0x80 : 0);
+	UWORD temp_addr = insn16(1) + cpu->X;
+	UBYTE temp1 = cpu_read8(temp_addr);
+	UBYTE temp = (temp1 >> 1) + ((cpu->P & FL_C) ? 0x80 : 0);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x01) ? FL_C : 0) | FLAG_NZ(temp);
-	Cycles += 7;
-	pce_write8(temp_addr, temp);
-	CPU.PC += 3;
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x01) ? FL_C : 0);
+	set_nz(temp);
+	cpu->cycles += 7;
+	cpu_write8(temp_addr, temp);
+	cpu->PC += 3;
 }
 
-OPCODE_FUNC ror_zp(void)
+OPCODE_FUNC ror_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp1 = get_8bit_zp(zp_addr);
-	UBYTE temp = (temp1 >> 1) + ((CPU.P & FL_C) ? 0x80 : 0);
+	UBYTE temp = (temp1 >> 1) + ((cpu->P & FL_C) ? 0x80 : 0);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x01) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x01) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC ror_zpx(void)
+OPCODE_FUNC ror_zpx(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1) + CPU.X;
+	UBYTE zp_addr = insn8(1) + cpu->X;
 	UBYTE temp1 = get_8bit_zp(zp_addr);
-	UBYTE temp = (temp1 >> 1) + ((CPU.P & FL_C) ? 0x80 : 0);
+	UBYTE temp = (temp1 >> 1) + ((cpu->P & FL_C) ? 0x80 : 0);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_T | FL_Z | FL_C)) | ((temp1 & 0x01) ? FL_C : 0) | FLAG_NZ(temp);
+	cpu->P = (cpu->P & ~(FL_T | FL_C)) | ((temp1 & 0x01) ? FL_C : 0);
+	set_nz(temp);
 	put_8bit_zp(zp_addr, temp);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC rti(void)
+OPCODE_FUNC rti(h6280_regs_t *cpu)
 {
 	/* FL_B reset in RTI */
-	pull_8bit(CPU.P);
-	CPU.P &= ~FL_B;
+	UBYTE temp;
+	pull_8bit(temp);
+	set_flags(cpu, temp & ~FL_B);
 	uint8_t t, t2;
 	pull_8bit(t);
 	pull_8bit(t2);
-	CPU.PC = (t | t2 << 8);
-	Cycles += 7;
+	cpu->PC = (t | t2 << 8);
+	cpu->cycles += 7;
+	chk_irq_pending();
 }
 
-OPCODE_FUNC rts(void)
+OPCODE_FUNC rts(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
+	cpu->P &= ~FL_T;
 	uint8_t t, t2;
 	pull_8bit(t);
 	pull_8bit(t2);
-	CPU.PC = (t | t2 << 8) + 1;
-	Cycles += 7;
+	cpu->PC = (t | t2 << 8) + 1;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC sax(void)
+OPCODE_FUNC sax(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.X;
-	CPU.P &= ~FL_T;
-	CPU.X = CPU.A;
-	CPU.A = temp;
-	CPU.PC++;
-	Cycles += 3;
+	UBYTE temp = cpu->X;
+	cpu->P &= ~FL_T;
+	cpu->X = cpu->A;
+	cpu->A = temp;
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC say(void)
+OPCODE_FUNC say(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.Y;
-	CPU.P &= ~FL_T;
-	CPU.Y = CPU.A;
-	CPU.A = temp;
-	CPU.PC++;
-	Cycles += 3;
+	UBYTE temp = cpu->Y;
+	cpu->P &= ~FL_T;
+	cpu->Y = cpu->A;
+	cpu->A = temp;
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC sbc_abs(void)
+OPCODE_FUNC sbc_abs(h6280_regs_t *cpu)
 {
-	sbc(abs_operand(CPU.PC + 1));
-	CPU.PC += 3;
-	Cycles += 5;
+	sbc(cpu, abs_operand(1));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sbc_absx(void)
+OPCODE_FUNC sbc_absx(h6280_regs_t *cpu)
 {
-	sbc(absx_operand(CPU.PC + 1));
-	CPU.PC += 3;
-	Cycles += 5;
+	sbc(cpu, absx_operand(1));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sbc_absy(void)
+OPCODE_FUNC sbc_absy(h6280_regs_t *cpu)
 {
-	sbc(absy_operand(CPU.PC + 1));
-	CPU.PC += 3;
-	Cycles += 5;
+	sbc(cpu, absy_operand(1));
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sbc_imm(void)
+OPCODE_FUNC sbc_imm(h6280_regs_t *cpu)
 {
-	sbc(imm_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 2;
+	sbc(cpu, insn8(1));
+	cpu->PC += 2;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC sbc_zp(void)
+OPCODE_FUNC sbc_zp(h6280_regs_t *cpu)
 {
-	sbc(zp_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 4;
+	sbc(cpu, zp_operand(1));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sbc_zpx(void)
+OPCODE_FUNC sbc_zpx(h6280_regs_t *cpu)
 {
-	sbc(zpx_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 4;
+	sbc(cpu, zpx_operand(1));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sbc_zpind(void)
+OPCODE_FUNC sbc_zpind(h6280_regs_t *cpu)
 {
-	sbc(zpind_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 7;
+	sbc(cpu, zpind_operand(1));
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC sbc_zpindx(void)
+OPCODE_FUNC sbc_zpindx(h6280_regs_t *cpu)
 {
-	sbc(zpindx_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 7;
+	sbc(cpu, zpindx_operand(1));
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC sbc_zpindy(void)
+OPCODE_FUNC sbc_zpindy(h6280_regs_t *cpu)
 {
-	sbc(zpindy_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 7;
+	sbc(cpu, zpindy_operand(1));
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC sec(void)
+OPCODE_FUNC sec(h6280_regs_t *cpu)
 {
-	CPU.P = (CPU.P | FL_C) & ~FL_T;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P = (cpu->P | FL_C) & ~FL_T;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC sed(void)
+OPCODE_FUNC sed(h6280_regs_t *cpu)
 {
-	CPU.P = (CPU.P | FL_D) & ~FL_T;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P = (cpu->P | FL_D) & ~FL_T;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC sei(void)
+OPCODE_FUNC sei(h6280_regs_t *cpu)
 {
-	CPU.P = (CPU.P | FL_I) & ~FL_T;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P = (cpu->P | FL_I) & ~FL_T;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC set(void)
+OPCODE_FUNC set(h6280_regs_t *cpu)
 {
-	CPU.P |= FL_T;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P |= FL_T;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC smb(UBYTE bit)
+OPCODE_FUNC smb(h6280_regs_t *cpu, UBYTE bit)
 {
-	UBYTE temp = imm_operand(CPU.PC + 1);
-	CPU.P &= ~FL_T;
+	UBYTE temp = insn8(1);
+	cpu->P &= ~FL_T;
 	put_8bit_zp(temp, get_8bit_zp(temp) | (1 << bit));
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC st0(void)
+OPCODE_FUNC st0(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_writeIO(0, imm_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	cpu_writeVDC(0, insn8(1));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC st1(void)
+OPCODE_FUNC st1(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_writeIO(2, imm_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	cpu_writeVDC(2, insn8(1));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC st2(void)
+OPCODE_FUNC st2(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_writeIO(3, imm_operand(CPU.PC + 1));
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	cpu_writeVDC(3, insn8(1));
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sta_abs(void)
+OPCODE_FUNC sta_abs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(pce_read16(CPU.PC + 1), CPU.A);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8_abs(insn16(1), cpu->A);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sta_absx(void)
+OPCODE_FUNC sta_absx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(pce_read16(CPU.PC + 1) + CPU.X, CPU.A);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8(insn16(1) + cpu->X, cpu->A);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sta_absy(void)
+OPCODE_FUNC sta_absy(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(pce_read16(CPU.PC + 1) + CPU.Y, CPU.A);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8(insn16(1) + cpu->Y, cpu->A);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sta_zp(void)
+OPCODE_FUNC sta_zp(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1), CPU.A);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1), cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sta_zpx(void)
+OPCODE_FUNC sta_zpx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1) + CPU.X, CPU.A);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1) + cpu->X, cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sta_zpind(void)
+OPCODE_FUNC sta_zpind(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(get_16bit_zp(imm_operand(CPU.PC + 1)), CPU.A);
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->P &= ~FL_T;
+	cpu_write8(get_16bit_zp(insn8(1)), cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC sta_zpindx(void)
+OPCODE_FUNC sta_zpindx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(get_16bit_zp(imm_operand(CPU.PC + 1) + CPU.X), CPU.A);
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->P &= ~FL_T;
+	cpu_write8(get_16bit_zp(insn8(1) + cpu->X), cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC sta_zpindy(void)
+OPCODE_FUNC sta_zpindy(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(get_16bit_zp(imm_operand(CPU.PC + 1)) + CPU.Y, CPU.A);
-	CPU.PC += 2;
-	Cycles += 7;
+	cpu->P &= ~FL_T;
+	cpu_write8(get_16bit_zp(insn8(1)) + cpu->Y, cpu->A);
+	cpu->PC += 2;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC stx_abs(void)
+OPCODE_FUNC stx_abs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(pce_read16(CPU.PC + 1), CPU.X);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8_abs(insn16(1), cpu->X);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC stx_zp(void)
+OPCODE_FUNC stx_zp(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1), CPU.X);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1), cpu->X);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC stx_zpy(void)
+OPCODE_FUNC stx_zpy(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1) + CPU.Y, CPU.X);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1) + cpu->Y, cpu->X);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sty_abs(void)
+OPCODE_FUNC sty_abs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(pce_read16(CPU.PC + 1), CPU.Y);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8_abs(insn16(1), cpu->Y);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC sty_zp(void)
+OPCODE_FUNC sty_zp(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1), CPU.Y);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1), cpu->Y);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sty_zpx(void)
+OPCODE_FUNC sty_zpx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1) + CPU.X, CPU.Y);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1) + cpu->X, cpu->Y);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC stz_abs(void)
+OPCODE_FUNC stz_abs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8(pce_read16(CPU.PC + 1), 0);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8_abs(insn16(1), 0);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC stz_absx(void)
+OPCODE_FUNC stz_absx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	pce_write8((pce_read16(CPU.PC + 1) + CPU.X), 0);
-	CPU.PC += 3;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu_write8((insn16(1) + cpu->X), 0);
+	cpu->PC += 3;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC stz_zp(void)
+OPCODE_FUNC stz_zp(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1), 0);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1), 0);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC stz_zpx(void)
+OPCODE_FUNC stz_zpx(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	put_8bit_zp(imm_operand(CPU.PC + 1) + CPU.X, 0);
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	put_8bit_zp(insn8(1) + cpu->X, 0);
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC sxy(void)
+OPCODE_FUNC sxy(h6280_regs_t *cpu)
 {
-	UBYTE temp = CPU.Y;
-	CPU.P &= ~FL_T;
-	CPU.Y = CPU.X;
-	CPU.X = temp;
-	CPU.PC++;
-	Cycles += 3;
+	UBYTE temp = cpu->Y;
+	cpu->P &= ~FL_T;
+	cpu->Y = cpu->X;
+	cpu->X = temp;
+	cpu->PC++;
+	cpu->cycles += 3;
 }
 
-OPCODE_FUNC tai(void)
+// Block transfers (TAI/TDD/TIA/TII/TIN) are split in runs that stay within
+// one 8KB bank on both sides. Runs between plain memory pages are moved
+// with pointers (memmove when the copy order doesn't matter), anything
+// else goes byte by byte through cpu_read8/cpu_write8 like the CPU would.
+#define bank_left_up(addr)    (0x2000 - ((addr) & 0x1FFF))
+#define bank_left_down(addr)  (((addr) & 0x1FFF) + 1)
+
+// IO ports that can be written in bulk: VDC, VCE and PSG writes never remap
+// memory or touch the timer/IRQ state
+#define bulk_io_port(addr)    (pce_handlerW(addr) == MAP_IO && ((addr) & 0x1FFF) < 0x0C00)
+
+OPCODE_FUNC tai(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	UWORD from = pce_read16(CPU.PC + 1);
-	UWORD to = pce_read16(CPU.PC + 3);
-	UWORD len = pce_read16(CPU.PC + 5);
+	cpu->P &= ~FL_T;
+	UWORD from = insn16(1);
+	UWORD to = insn16(3);
+	UWORD len = insn16(5);
 	if ( len == 0 ) len = 0xffff;
 	UWORD alternate = 0;
 
-	Cycles += (6 * len) + 17;
-	while (len-- != 0)
+	cpu->cycles += (6 * len) + 17;
+	while (len != 0)
 	{
-		pce_write8(to++, pce_read8(from + alternate));
+		uint8_t *src = PageR[from >> 13];
+		uint8_t *dst = PageW[to >> 13];
+
+		if (src && dst && (from & 0x1FFF) != 0x1FFF)
+		{
+			UWORD n = MIN(len, bank_left_up(to));
+			src += from;
+			dst += to;
+			for (UWORD i = 0; i < n; i++)
+			{
+				dst[i] = src[alternate];
+				alternate ^= 1;
+			}
+			to += n;
+			len -= n;
+			continue;
+		}
+
+		cpu_write8(to++, cpu_read8(from + alternate));
 		alternate ^= 1;
+		len--;
 	}
-	CPU.PC += 7;
+	cpu->PC += 7;
 }
 
-OPCODE_FUNC csh(void)
+OPCODE_FUNC csh(h6280_regs_t *cpu)
 {
 	PCE.Timer.cycles_per_line = 455; /* 21477270 / 3 / 60 / 263 */ /* 7.16 Mhz CPU clock */
-	CPU.PC++;
-	Cycles+=3;
+	cpu->PC++;
+	cpu->cycles+=3;
 }
 
-OPCODE_FUNC csl(void)
+OPCODE_FUNC csl(h6280_regs_t *cpu)
 {
 	PCE.Timer.cycles_per_line = 113; /* 21477270 / 12 / 60 / 263 */ /* 1.78 Mhz CPU clock */
-	CPU.PC++;
-	Cycles+=3;
+	cpu->PC++;
+	cpu->cycles+=3;
 }
 
 static int tamwrite = -1;
 static int tamread = 0;
 
-OPCODE_FUNC tam(void)
+OPCODE_FUNC tam(h6280_regs_t *cpu)
 {
-	UBYTE bitfld = imm_operand(CPU.PC + 1);
+	UBYTE bitfld = insn8(1);
 
 	tamwrite = -1;
 	for (int i = 0; i < 8; i++)
 	{
 		if (bitfld & (1 << i))
 		{
-			pce_bank_set(i, CPU.A);
-			tamwrite = CPU.A;
+			pce_bank_set(i, cpu->A);
+			tamwrite = cpu->A;
 		}
 	}
+	cpu->win_len = 0;
 
-	CPU.P &= ~FL_T;
-	CPU.PC += 2;
-	Cycles += 5;
+	cpu->P &= ~FL_T;
+	cpu->PC += 2;
+	cpu->cycles += 5;
 }
 
-OPCODE_FUNC tax(void)
+OPCODE_FUNC tax(h6280_regs_t *cpu)
 {
-	CPU.X = CPU.A;
-	chk_flnz_8bit(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->X = cpu->A;
+	chk_flnz_8bit(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC tay(void)
+OPCODE_FUNC tay(h6280_regs_t *cpu)
 {
-	CPU.Y = CPU.A;
-	chk_flnz_8bit(CPU.A);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->Y = cpu->A;
+	chk_flnz_8bit(cpu->A);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC tdd(void)
+OPCODE_FUNC tdd(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	UWORD from = pce_read16(CPU.PC + 1);
-	UWORD to = pce_read16(CPU.PC + 3);
-	UWORD len = pce_read16(CPU.PC + 5);
+	cpu->P &= ~FL_T;
+	UWORD from = insn16(1);
+	UWORD to = insn16(3);
+	UWORD len = insn16(5);
 	if ( len == 0 ) len = 0xffff;
 
-	Cycles += (6 * len) + 17;
-	while (len-- != 0)
+	cpu->cycles += (6 * len) + 17;
+	while (len != 0)
 	{
-		pce_write8(to--, pce_read8(from--));
+		uint8_t *src = PageR[from >> 13];
+		uint8_t *dst = PageW[to >> 13];
+
+		if (src && dst)
+		{
+			UWORD n = MIN(len, MIN(bank_left_down(from), bank_left_down(to)));
+			src += from;
+			dst += to;
+			// Copying downwards, a destination just below the source sees its own writes
+			if (dst < src && dst + n > src) {
+				for (UWORD i = 0; i < n; i++)
+					*dst-- = *src--;
+			} else {
+				memmove(dst - (n - 1), src - (n - 1), n);
+			}
+			from -= n;
+			to -= n;
+			len -= n;
+			continue;
+		}
+
+		cpu_write8(to--, cpu_read8(from--));
+		len--;
 	}
-	CPU.PC += 7;
+	cpu->PC += 7;
 }
 
-OPCODE_FUNC tia(void)
+OPCODE_FUNC tia(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	UWORD from = pce_read16(CPU.PC + 1);
-	UWORD to = pce_read16(CPU.PC + 3);
-	UWORD len = pce_read16(CPU.PC + 5);
+	cpu->P &= ~FL_T;
+	UWORD from = insn16(1);
+	UWORD to = insn16(3);
+	UWORD len = insn16(5);
 	if ( len == 0 ) len = 0xffff;
 	UWORD alternate = 0;
 
-	Cycles += (6 * len) + 17;
-	while (len-- != 0)
+	cpu->cycles += (6 * len) + 17;
+	while (len != 0)
 	{
-		pce_write8(to + alternate, pce_read8(from++));
+		uint8_t *src = PageR[from >> 13];
+		uint8_t *dst = PageW[to >> 13];
+
+		if (src && (to & 0x1FFF) != 0x1FFF)
+		{
+			UWORD n = MIN(len, bank_left_up(from));
+			src += from;
+			if (dst) {
+				dst += to;
+				for (UWORD i = 0; i < n; i++)
+				{
+					dst[alternate] = src[i];
+					alternate ^= 1;
+				}
+			} else if (bulk_io_port(to)) {
+				regs_sync(cpu);
+				if ((to & 0x1F03) == 0x0002) {
+					// VDC data port, typically a VRAM upload
+					pce_vdc_write_block(src, n, alternate);
+				} else {
+					for (UWORD i = 0; i < n; i++)
+						pce_writeIO(to + (alternate ^ (i & 1)), src[i]);
+				}
+				alternate ^= n & 1;
+				cpu->max_cycles = PCE.NextEvent;
+			} else {
+				goto byte;
+			}
+			from += n;
+			len -= n;
+			continue;
+		}
+
+	byte:
+		cpu_write8(to + alternate, cpu_read8(from++));
 		alternate ^= 1;
+		len--;
 	}
-	CPU.PC += 7;
+	cpu->PC += 7;
 }
 
-OPCODE_FUNC tii(void)
+OPCODE_FUNC tii(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	UWORD from = pce_read16(CPU.PC + 1);
-	UWORD to = pce_read16(CPU.PC + 3);
-	UWORD len = pce_read16(CPU.PC + 5);
+	cpu->P &= ~FL_T;
+	UWORD from = insn16(1);
+	UWORD to = insn16(3);
+	UWORD len = insn16(5);
 	if ( len == 0 ) len = 0xffff;
 
-	Cycles += (6 * len) + 17;
-	while (len-- != 0)
+	cpu->cycles += (6 * len) + 17;
+	while (len != 0)
 	{
-		pce_write8(to++, pce_read8(from++));
+		uint8_t *src = PageR[from >> 13];
+		uint8_t *dst = PageW[to >> 13];
+
+		if (src && dst)
+		{
+			UWORD n = MIN(len, MIN(bank_left_up(from), bank_left_up(to)));
+			src += from;
+			dst += to;
+			// Copying upwards, a destination just above the source sees its own
+			// writes (games use this to fill memory with a pattern)
+			if (dst > src && dst < src + n) {
+				for (UWORD i = 0; i < n; i++)
+					dst[i] = src[i];
+			} else {
+				memmove(dst, src, n);
+			}
+			from += n;
+			to += n;
+			len -= n;
+			continue;
+		}
+
+		cpu_write8(to++, cpu_read8(from++));
+		len--;
 	}
-	CPU.PC += 7;
+	cpu->PC += 7;
 }
 
-OPCODE_FUNC tin(void)
+OPCODE_FUNC tin(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	UWORD from = pce_read16(CPU.PC + 1);
-	UWORD to = pce_read16(CPU.PC + 3);
-	UWORD len = pce_read16(CPU.PC + 5);
+	cpu->P &= ~FL_T;
+	UWORD from = insn16(1);
+	UWORD to = insn16(3);
+	UWORD len = insn16(5);
 	if ( len == 0 ) len = 0xffff;
 
-	Cycles += (6 * len) + 17;
-	while (len-- != 0)
+	cpu->cycles += (6 * len) + 17;
+	while (len != 0)
 	{
-		pce_write8(to, pce_read8(from++));
+		uint8_t *src = PageR[from >> 13];
+		uint8_t *dst = PageW[to >> 13];
+
+		if (src && (dst || bulk_io_port(to)))
+		{
+			UWORD n = MIN(len, bank_left_up(from));
+			src += from;
+			if (dst) {
+				dst += to;
+				for (UWORD i = 0; i < n; i++)
+					*dst = src[i];
+			} else {
+				regs_sync(cpu);
+				for (UWORD i = 0; i < n; i++)
+					pce_writeIO(to, src[i]);
+				cpu->max_cycles = PCE.NextEvent;
+			}
+			from += n;
+			len -= n;
+			continue;
+		}
+
+		cpu_write8(to, cpu_read8(from++));
+		len--;
 	}
-	CPU.PC += 7;
+	cpu->PC += 7;
 }
 
-OPCODE_FUNC tma(void)
+OPCODE_FUNC tma(h6280_regs_t *cpu)
 {
-	UBYTE bitfld = imm_operand(CPU.PC + 1);
+	UBYTE bitfld = insn8(1);
 
 	if ( bitfld & 0xff )
 	{
@@ -2301,157 +2889,165 @@ OPCODE_FUNC tma(void)
 		{
 			if (bitfld & (1 << i))
 			{
-				CPU.A = PCE.MMR[i];
+				cpu->A = PCE.MMR[i];
 			}
 		}
-		tamread = CPU.A;
+		tamread = cpu->A;
 	} else {
-		CPU.A = ( tamwrite != -1 ) ? tamwrite : tamread ;
+		cpu->A = ( tamwrite != -1 ) ? tamwrite : tamread ;
 	}
-	CPU.P &= ~FL_T;
-	CPU.PC += 2;
-	Cycles += 4;
+	cpu->P &= ~FL_T;
+	cpu->PC += 2;
+	cpu->cycles += 4;
 }
 
-OPCODE_FUNC trb_abs(void)
+OPCODE_FUNC trb_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp = pce_read8(temp_addr);
-	UBYTE temp1 = (~CPU.A) & temp;
+	UWORD temp_addr = insn16(1);
+	UBYTE temp = cpu_read8(temp_addr);
+	UBYTE temp1 = (~cpu->A) & temp;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp1 & (FL_N | FL_V)) | ((temp & CPU.A) ? 0 : FL_Z);
-	pce_write8(temp_addr, temp1);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp1 & FL_V);
+	set_nz_bit(temp1, temp & cpu->A);
+	cpu_write8(temp_addr, temp1);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC trb_zp(void)
+OPCODE_FUNC trb_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp = get_8bit_zp(zp_addr);
-	UBYTE temp1 = (~CPU.A) & temp;
+	UBYTE temp1 = (~cpu->A) & temp;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp1 & (FL_N | FL_V)) | ((temp & CPU.A) ? 0 : FL_Z);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp1 & FL_V);
+	set_nz_bit(temp1, temp & cpu->A);
 	put_8bit_zp(zp_addr, temp1);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC tsb_abs(void)
+OPCODE_FUNC tsb_abs(h6280_regs_t *cpu)
 {
-	UWORD temp_addr = pce_read16(CPU.PC + 1);
-	UBYTE temp = pce_read8(temp_addr);
-	UBYTE temp1 = CPU.A | temp;
+	UWORD temp_addr = insn16(1);
+	UBYTE temp = cpu_read8(temp_addr);
+	UBYTE temp1 = cpu->A | temp;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp1 & (FL_N | FL_V)) | ((temp & CPU.A) ? 0 : FL_Z);
-	pce_write8(temp_addr, temp1);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp1 & FL_V);
+	set_nz_bit(temp1, temp & cpu->A);
+	cpu_write8(temp_addr, temp1);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC tsb_zp(void)
+OPCODE_FUNC tsb_zp(h6280_regs_t *cpu)
 {
-	UBYTE zp_addr = imm_operand(CPU.PC + 1);
+	UBYTE zp_addr = insn8(1);
 	UBYTE temp = get_8bit_zp(zp_addr);
-	UBYTE temp1 = CPU.A | temp;
+	UBYTE temp1 = cpu->A | temp;
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp1 & (FL_N | FL_V)) | ((temp & CPU.A) ? 0 : FL_Z);
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp1 & FL_V);
+	set_nz_bit(temp1, temp & cpu->A);
 	put_8bit_zp(zp_addr, temp1);
-	CPU.PC += 2;
-	Cycles += 6;
+	cpu->PC += 2;
+	cpu->cycles += 6;
 }
 
-OPCODE_FUNC tstins_abs(void)
+OPCODE_FUNC tstins_abs(h6280_regs_t *cpu)
 {
-	UBYTE imm_addr = imm_operand(CPU.PC + 1);
-	UBYTE temp = abs_operand(CPU.PC + 2);
+	UBYTE imm_addr = insn8(1);
+	UBYTE temp = abs_operand(2);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((temp & imm_addr) ? 0 : FL_Z);
-	CPU.PC += 4;
-	Cycles += 8;
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, temp & imm_addr);
+	cpu->PC += 4;
+	cpu->cycles += 8;
 }
 
-OPCODE_FUNC tstins_absx(void)
+OPCODE_FUNC tstins_absx(h6280_regs_t *cpu)
 {
-	UBYTE imm_addr = imm_operand(CPU.PC + 1);
-	UBYTE temp = absx_operand(CPU.PC + 2);
+	UBYTE imm_addr = insn8(1);
+	UBYTE temp = absx_operand(2);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((temp & imm_addr) ? 0 : FL_Z);
-	CPU.PC += 4;
-	Cycles += 8;
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, temp & imm_addr);
+	cpu->PC += 4;
+	cpu->cycles += 8;
 }
 
-OPCODE_FUNC tstins_zp(void)
+OPCODE_FUNC tstins_zp(h6280_regs_t *cpu)
 {
-	UBYTE imm_addr = imm_operand(CPU.PC + 1);
-	UBYTE temp = zp_operand(CPU.PC + 2);
+	UBYTE imm_addr = insn8(1);
+	UBYTE temp = zp_operand(2);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((temp & imm_addr) ? 0 : FL_Z);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, temp & imm_addr);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC tstins_zpx(void)
+OPCODE_FUNC tstins_zpx(h6280_regs_t *cpu)
 {
-	UBYTE imm_addr = imm_operand(CPU.PC + 1);
-	UBYTE temp = zpx_operand(CPU.PC + 2);
+	UBYTE imm_addr = insn8(1);
+	UBYTE temp = zpx_operand(2);
 
-	CPU.P = (CPU.P & ~(FL_N | FL_V | FL_T | FL_Z)) | (temp & (FL_N | FL_V)) | ((temp & imm_addr) ? 0 : FL_Z);
-	CPU.PC += 3;
-	Cycles += 7;
+	cpu->P = (cpu->P & ~(FL_V | FL_T)) | (temp & FL_V);
+	set_nz_bit(temp, temp & imm_addr);
+	cpu->PC += 3;
+	cpu->cycles += 7;
 }
 
-OPCODE_FUNC tsx(void)
+OPCODE_FUNC tsx(h6280_regs_t *cpu)
 {
-	CPU.X = CPU.S;
-	chk_flnz_8bit(CPU.S);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->X = cpu->S;
+	chk_flnz_8bit(cpu->S);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC txa(void)
+OPCODE_FUNC txa(h6280_regs_t *cpu)
 {
-	CPU.A = CPU.X;
-	chk_flnz_8bit(CPU.X);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->A = cpu->X;
+	chk_flnz_8bit(cpu->X);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC txs(void)
+OPCODE_FUNC txs(h6280_regs_t *cpu)
 {
-	CPU.P &= ~FL_T;
-	CPU.S = CPU.X;
-	CPU.PC++;
-	Cycles += 2;
+	cpu->P &= ~FL_T;
+	cpu->S = cpu->X;
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC tya(void)
+OPCODE_FUNC tya(h6280_regs_t *cpu)
 {
-	CPU.A = CPU.Y;
-	chk_flnz_8bit(CPU.Y);
-	CPU.PC++;
-	Cycles += 2;
+	cpu->A = cpu->Y;
+	chk_flnz_8bit(cpu->Y);
+	cpu->PC++;
+	cpu->cycles += 2;
 }
 
-OPCODE_FUNC interrupt(unsigned type)
+OPCODE_FUNC interrupt(h6280_regs_t *cpu, unsigned type)
 {
 	// pcetech.txt says the program should clear the irq line by reading 0x1403
 	// however in practice it seems to break many games if we don't clear it?
 
 	TRACE_CPU("CPU interrupt: %d\n", type);
-	push_16bit(CPU.PC);
-	push_8bit(CPU.P);
-	CPU.P &= ~(FL_D|FL_T);
-	CPU.P |= FL_I;
+	push_16bit(cpu->PC);
+	push_8bit(get_flags(cpu));
+	cpu->P &= ~(FL_D|FL_T);
+	cpu->P |= FL_I;
 	if (type & INT_IRQ1) {
 		CPU.irq_lines &= ~INT_IRQ1;
-		CPU.PC = pce_read16(VEC_IRQ1);
+		cpu->PC = pce_read16(VEC_IRQ1);
 	} else if (type & INT_IRQ2) {
 		CPU.irq_lines &= ~INT_IRQ2;
-		CPU.PC = pce_read16(VEC_IRQ2);
+		cpu->PC = pce_read16(VEC_IRQ2);
 	} else {
 		CPU.irq_lines &= ~INT_TIMER;
-		CPU.PC = pce_read16(VEC_TIMER);
+		cpu->PC = pce_read16(VEC_TIMER);
 	}
-	Cycles += 7;
+	cpu->cycles += 7;
 }
@@ -0,0 +1,254 @@
+// h6280_optable.h - HuC6280 opcode to handler mapping
+//
+// Included by h6280.c with OPCODE(n, f) defined to build either the switch
+// or the threaded dispatch table. Unlisted opcodes are illegal (NOP).
+//
+OPCODE(0x00, brk(cpu))									// BRK
+OPCODE(0x01, ora_zpindx(cpu))							// ORA (IND,X)
+OPCODE(0x02, sxy(cpu))									// SXY
+OPCODE(0x03, st0(cpu))									// ST0 #$nn
+OPCODE(0x04, tsb_zp(cpu))								// TSB $ZZ
+OPCODE(0x05, ora_zp(cpu))								// ORA $ZZ
+OPCODE(0x06, asl_zp(cpu))								// ASL $ZZ
+OPCODE(0x07, rmb(cpu, 0))								// RMB0 $ZZ
+OPCODE(0x08, php(cpu))									// PHP
+OPCODE(0x09, ora_imm(cpu))								// ORA #$nn
+OPCODE(0x0A, asl_a(cpu))								// ASL A
+OPCODE(0x0C, tsb_abs(cpu))								// TSB $hhll
+OPCODE(0x0D, ora_abs(cpu))								// ORA $hhll
+OPCODE(0x0E, asl_abs(cpu))								// ASL $hhll
+OPCODE(0x0F, bbr(cpu, 0))								// BBR0 $ZZ,$rr
+
+OPCODE(0x10, bpl(cpu))									// BPL REL
+OPCODE(0x11, ora_zpindy(cpu))							// ORA (IND),Y
+OPCODE(0x12, ora_zpind(cpu))							// ORA (IND)
+OPCODE(0x13, st1(cpu))									// ST1 #$nn
+OPCODE(0x14, trb_zp(cpu))								// TRB $ZZ
+OPCODE(0x15, ora_zpx(cpu))								// ORA $ZZ,X
+OPCODE(0x16, asl_zpx(cpu))								// ASL $ZZ,X
+OPCODE(0x17, rmb(cpu, 1))								// RMB1 $ZZ
+OPCODE(0x18, clc(cpu))									// CLC
+OPCODE(0x19, ora_absy(cpu))								// ORA $hhll,Y
+OPCODE(0x1A, inc_a(cpu))								// INC A
+OPCODE(0x1C, trb_abs(cpu))								// TRB $hhll
+OPCODE(0x1D, ora_absx(cpu))								// ORA $hhll,X
+OPCODE(0x1E, asl_absx(cpu))								// ASL $hhll,X
+OPCODE(0x1F, bbr(cpu, 1))								// BBR1 $ZZ,$rr
+
+OPCODE(0x20, jsr(cpu))									// JSR $hhll
+OPCODE(0x21, and_zpindx(cpu))							// AND (IND,X)
+OPCODE(0x22, sax(cpu))									// SAX
+OPCODE(0x23, st2(cpu))									// ST2 #$nn
+OPCODE(0x24, bit_zp(cpu))								// BIT $ZZ
+OPCODE(0x25, and_zp(cpu))								// AND $ZZ
+OPCODE(0x26, rol_zp(cpu))								// ROL $ZZ
+OPCODE(0x27, rmb(cpu, 2))								// RMB2 $ZZ
+OPCODE(0x28, plp(cpu))									// PLP
+OPCODE(0x29, and_imm(cpu))								// AND #$nn
+OPCODE(0x2A, rol_a(cpu))								// ROL A
+OPCODE(0x2C, bit_abs(cpu))								// BIT $hhll
+OPCODE(0x2D, and_abs(cpu))								// AND $hhll
+OPCODE(0x2E, rol_abs(cpu))								// ROL $hhll
+OPCODE(0x2F, bbr(cpu, 2))								// BBR2 $ZZ,$rr
+
+OPCODE(0x30, bmi(cpu))									// BMI $rr
+OPCODE(0x31, and_zpindy(cpu))							// AND (IND),Y
+OPCODE(0x32, and_zpind(cpu))							// AND (IND)
+OPCODE(0x34, bit_zpx(cpu))								// BIT $ZZ,X
+OPCODE(0x35, and_zpx(cpu))								// AND $ZZ,X
+OPCODE(0x36, rol_zpx(cpu))								// ROL $ZZ,X
+OPCODE(0x37, rmb(cpu, 3))								// RMB3 $ZZ
+OPCODE(0x38, sec(cpu))									// SEC
+OPCODE(0x39, and_absy(cpu))								// AND $hhll,Y
+OPCODE(0x3A, dec_a(cpu))								// DEC A
+OPCODE(0x3C, bit_absx(cpu))								// BIT $hhll,X
+OPCODE(0x3D, and_absx(cpu))								// AND $hhll,X
+OPCODE(0x3E, rol_absx(cpu))								// ROL $hhll,X
+OPCODE(0x3F, bbr(cpu, 3))								// BBR3 $ZZ,$rr
+
+OPCODE(0x40, rti(cpu))									// RTI
+OPCODE(0x41, eor_zpindx(cpu))							// EOR (IND,X)
+OPCODE(0x42, say(cpu))									// SAY
+OPCODE(0x43, tma(cpu))									// TMAi
+OPCODE(0x44, bsr(cpu))									// BSR $rr
+OPCODE(0x45, eor_zp(cpu))								// EOR $ZZ
+OPCODE(0x46, lsr_zp(cpu))								// LSR $ZZ
+OPCODE(0x47, rmb(cpu, 4))								// RMB4 $ZZ
+OPCODE(0x48, pha(cpu))									// PHA
+OPCODE(0x49, eor_imm(cpu))								// EOR #$nn
+OPCODE(0x4A, lsr_a(cpu))								// LSR A
+OPCODE(0x4C, jmp(cpu))									// JMP $hhll
+OPCODE(0x4D, eor_abs(cpu))								// EOR $hhll
+OPCODE(0x4E, lsr_abs(cpu))								// LSR $hhll
+OPCODE(0x4F, bbr(cpu, 4))								// BBR4 $ZZ,$rr
+
+OPCODE(0x50, bvc(cpu))									// BVC $rr
+OPCODE(0x51, eor_zpindy(cpu))							// EOR (IND),Y
+OPCODE(0x52, eor_zpind(cpu))							// EOR (IND)
+OPCODE(0x53, tam(cpu))									// TAMi
+OPCODE(0x54, csl(cpu))									// CSL
+OPCODE(0x55, eor_zpx(cpu))								// EOR $ZZ,X
+OPCODE(0x56, lsr_zpx(cpu))								// LSR $ZZ,X
+OPCODE(0x57, rmb(cpu, 5))								// RMB5 $ZZ
+OPCODE(0x58, cli(cpu))									// CLI
+OPCODE(0x59, eor_absy(cpu))								// EOR $hhll,Y
+OPCODE(0x5A, phy(cpu))									// PHY
+OPCODE(0x5D, eor_absx(cpu))								// EOR $hhll,X
+OPCODE(0x5E, lsr_absx(cpu))								// LSR $hhll,X
+OPCODE(0x5F, bbr(cpu, 5))								// BBR5 $ZZ,$rr
+
+OPCODE(0x60, rts(cpu))									// RTS
+OPCODE(0x61, adc_zpindx(cpu))							// ADC ($ZZ,X)
+OPCODE(0x62, cla(cpu))									// CLA
+OPCODE(0x64, stz_zp(cpu))								// STZ $ZZ
+OPCODE(0x65, adc_zp(cpu))								// ADC $ZZ
+OPCODE(0x66, ror_zp(cpu))								// ROR $ZZ
+OPCODE(0x67, rmb(cpu, 6))								// RMB6 $ZZ
+OPCODE(0x68, pla(cpu))									// PLA
+OPCODE(0x69, adc_imm(cpu))								// ADC #$nn
+OPCODE(0x6A, ror_a(cpu))								// ROR A
+OPCODE(0x6C, jmp_absind(cpu))							// JMP ($hhll)
+OPCODE(0x6D, adc_abs(cpu))								// ADC $hhll
+OPCODE(0x6E, ror_abs(cpu))								// ROR $hhll
+OPCODE(0x6F, bbr(cpu, 6))								// BBR6 $ZZ,$rr
+
+OPCODE(0x70, bvs(cpu))									// BVS $rr
+OPCODE(0x71, adc_zpindy(cpu))							// ADC ($ZZ),Y
+OPCODE(0x72, adc_zpind(cpu))							// ADC ($ZZ)
+OPCODE(0x73, tii(cpu))									// TII $SHSL,$DHDL,$LHLL
+OPCODE(0x74, stz_zpx(cpu))								// STZ $ZZ,X
+OPCODE(0x75, adc_zpx(cpu))								// ADC $ZZ,X
+OPCODE(0x76, ror_zpx(cpu))								// ROR $ZZ,X
+OPCODE(0x77, rmb(cpu, 7))								// RMB7 $ZZ
+OPCODE(0x78, sei(cpu))									// SEI
+OPCODE(0x79, adc_absy(cpu))								// ADC $hhll,Y
+OPCODE(0x7A, ply(cpu))									// PLY
+OPCODE(0x7C, jmp_absindx(cpu))							// JMP $hhll,X
+OPCODE(0x7D, adc_absx(cpu))								// ADC $hhll,X
+OPCODE(0x7E, ror_absx(cpu))								// ROR $hhll,X
+OPCODE(0x7F, bbr(cpu, 7))								// BBR7 $ZZ,$rr
+
+OPCODE(0x80, bra(cpu))									// BRA $rr
+OPCODE(0x81, sta_zpindx(cpu))							// STA (IND,X)
+OPCODE(0x82, clx(cpu))									// CLX
+OPCODE(0x83, tstins_zp(cpu))							// TST #$nn,$ZZ
+OPCODE(0x84, sty_zp(cpu))								// STY $ZZ
+OPCODE(0x85, sta_zp(cpu))								// STA $ZZ
+OPCODE(0x86, stx_zp(cpu))								// STX $ZZ
+OPCODE(0x87, smb(cpu, 0))								// SMB0 $ZZ
+OPCODE(0x88, dey(cpu))									// DEY
+OPCODE(0x89, bit_imm(cpu))								// BIT #$nn
+OPCODE(0x8A, txa(cpu))									// TXA
+OPCODE(0x8C, sty_abs(cpu))								// STY $hhll
+OPCODE(0x8D, sta_abs(cpu))								// STA $hhll
+OPCODE(0x8E, stx_abs(cpu))								// STX $hhll
+OPCODE(0x8F, bbs(cpu, 0))								// BBS0 $ZZ,$rr
+
+OPCODE(0x90, bcc(cpu))									// BCC $rr
+OPCODE(0x91, sta_zpindy(cpu))							// STA (IND),Y
+OPCODE(0x92, sta_zpind(cpu))							// STA (IND)
+OPCODE(0x93, tstins_abs(cpu))							// TST #$nn,$hhll
+OPCODE(0x94, sty_zpx(cpu))								// STY $ZZ,X
+OPCODE(0x95, sta_zpx(cpu))								// STA $ZZ,X
+OPCODE(0x96, stx_zpy(cpu))								// STX $ZZ,Y
+OPCODE(0x97, smb(cpu, 1))								// SMB1 $ZZ
+OPCODE(0x98, tya(cpu))									// TYA
+OPCODE(0x99, sta_absy(cpu))								// STA $hhll,Y
+OPCODE(0x9A, txs(cpu))									// TXS
+OPCODE(0x9C, stz_abs(cpu))								// STZ $hhll
+OPCODE(0x9D, sta_absx(cpu))								// STA $hhll,X
+OPCODE(0x9E, stz_absx(cpu))								// STZ $hhll,X
+OPCODE(0x9F, bbs(cpu, 1))								// BBS1 $ZZ,$rr
+
+OPCODE(0xA0, ldy_imm(cpu))								// LDY #$nn
+OPCODE(0xA1, lda_zpindx(cpu))							// LDA (IND,X)
+OPCODE(0xA2, ldx_imm(cpu))								// LDX #$nn
+OPCODE(0xA3, tstins_zpx(cpu))							// TST #$nn,$ZZ,X
+OPCODE(0xA4, ldy_zp(cpu))								// LDY $ZZ
+OPCODE(0xA5, lda_zp(cpu))								// LDA $ZZ
+OPCODE(0xA6, ldx_zp(cpu))								// LDX $ZZ
+OPCODE(0xA7, smb(cpu, 2))								// SMB2 $ZZ
+OPCODE(0xA8, tay(cpu))									// TAY
+OPCODE(0xA9, lda_imm(cpu))								// LDA #$nn
+OPCODE(0xAA, tax(cpu))									// TAX
+OPCODE(0xAC, ldy_abs(cpu))								// LDY $hhll
+OPCODE(0xAD, lda_abs(cpu))								// LDA $hhll
+OPCODE(0xAE, ldx_abs(cpu))								// LDX $hhll
+OPCODE(0xAF, bbs(cpu, 2))								// BBS2 $ZZ,$rr
+
+OPCODE(0xB0, bcs(cpu))									// BCS $rr
+OPCODE(0xB1, lda_zpindy(cpu))							// LDA (IND),Y
+OPCODE(0xB2, lda_zpind(cpu))							// LDA  (IND)
+OPCODE(0xB3, tstins_absx(cpu))							// TST #$nn,$hhll,X
+OPCODE(0xB4, ldy_zpx(cpu))								// LDY $ZZ,X
+OPCODE(0xB5, lda_zpx(cpu))								// LDA $ZZ,X
+OPCODE(0xB6, ldx_zpy(cpu))								// LDX $ZZ,Y
+OPCODE(0xB7, smb(cpu, 3))								// SMB3 $ZZ
+OPCODE(0xB8, clv(cpu))									// CLV
+OPCODE(0xB9, lda_absy(cpu))								// LDA $hhll,Y
+OPCODE(0xBA, tsx(cpu))									// TSX
+OPCODE(0xBC, ldy_absx(cpu))								// LDY $hhll,X
+OPCODE(0xBD, lda_absx(cpu))								// LDA $hhll,X
+OPCODE(0xBE, ldx_absy(cpu))								// LDX $hhll,Y
+OPCODE(0xBF, bbs(cpu, 3))								// BBS3 $ZZ,$rr
+
+OPCODE(0xC0, cpy_imm(cpu))								// CPY #$nn
+OPCODE(0xC1, cmp_zpindx(cpu))							// CMP (IND,X)
+OPCODE(0xC2, cly(cpu))									// CLY
+OPCODE(0xC3, tdd(cpu))									// TDD $SHSL,$DHDL,$LHLL
+OPCODE(0xC4, cpy_zp(cpu))								// CPY $ZZ
+OPCODE(0xC5, cmp_zp(cpu))								// CMP $ZZ
+OPCODE(0xC6, dec_zp(cpu))								// DEC $ZZ
+OPCODE(0xC7, smb(cpu, 4))								// SMB4 $ZZ
+OPCODE(0xC8, iny(cpu))									// INY
+OPCODE(0xC9, cmp_imm(cpu))								// CMP #$nn
+OPCODE(0xCA, dex(cpu))									// DEX
+OPCODE(0xCC, cpy_abs(cpu))								// CPY $hhll
+OPCODE(0xCD, cmp_abs(cpu))								// CMP $hhll
+OPCODE(0xCE, dec_abs(cpu))								// DEC $hhll
+OPCODE(0xCF, bbs(cpu, 4))								// BBS4 $ZZ,$rr
+
+OPCODE(0xD0, bne(cpu))									// BNE $rr
+OPCODE(0xD1, cmp_zpindy(cpu))							// CMP (IND),Y
+OPCODE(0xD2, cmp_zpind(cpu))							// CMP (IND)
+OPCODE(0xD3, tin(cpu))									// TIN $SHSL,$DHDL,$LHLL
+OPCODE(0xD4, csh(cpu))									// CSH
+OPCODE(0xD5, cmp_zpx(cpu))								// CMP $ZZ,X
+OPCODE(0xD6, dec_zpx(cpu))								// DEC $ZZ,X
+OPCODE(0xD7, smb(cpu, 5))								// SMB5 $ZZ
+OPCODE(0xD8, cld(cpu))									// CLD
+OPCODE(0xD9, cmp_absy(cpu))								// CMP $hhll,Y
+OPCODE(0xDA, phx(cpu))									// PHX
+OPCODE(0xDD, cmp_absx(cpu))								// CMP $hhll,X
+OPCODE(0xDE, dec_absx(cpu))								// DEC $hhll,X
+OPCODE(0xDF, bbs(cpu, 5))								// BBS5 $ZZ,$rr
+
+OPCODE(0xE0, cpx_imm(cpu))								// CPX #$nn
+OPCODE(0xE1, sbc_zpindx(cpu))							// SBC (IND,X)
+OPCODE(0xE3, tia(cpu))									// TIA $SHSL,$DHDL,$LHLL
+OPCODE(0xE4, cpx_zp(cpu))								// CPX $ZZ
+OPCODE(0xE5, sbc_zp(cpu))								// SBC $ZZ
+OPCODE(0xE6, inc_zp(cpu))								// INC $ZZ
+OPCODE(0xE7, smb(cpu, 6))								// SMB6 $ZZ
+OPCODE(0xE8, inx(cpu))									// INX
+OPCODE(0xE9, sbc_imm(cpu))								// SBC #$nn
+OPCODE(0xEA, nop(cpu))									// NOP
+OPCODE(0xEC, cpx_abs(cpu))								// CPX $hhll
+OPCODE(0xED, sbc_abs(cpu))								// SBC $hhll
+OPCODE(0xEE, inc_abs(cpu))								// INC $hhll
+OPCODE(0xEF, bbs(cpu, 6))								// BBS6 $ZZ,$rr
+OPCODE(0xF0, beq(cpu))									// BEQ $rr
+
+OPCODE(0xF1, sbc_zpindy(cpu))							// SBC (IND),Y
+OPCODE(0xF2, sbc_zpind(cpu))							// SBC (IND)
+OPCODE(0xF3, tai(cpu))									// TAI $SHSL,$DHDL,$LHLL
+OPCODE(0xF4, set(cpu))									// SET
+OPCODE(0xF5, sbc_zpx(cpu))								// SBC $ZZ,X
+OPCODE(0xF6, inc_zpx(cpu))								// INC $ZZ,X
+OPCODE(0xF7, smb(cpu, 7))								// SMB7 $ZZ
+OPCODE(0xF8, sed(cpu))									// SED
+OPCODE(0xF9, sbc_absy(cpu))								// SBC $hhll,Y
+OPCODE(0xFA, plx(cpu))									// PLX
+OPCODE(0xFD, sbc_absx(cpu))								// SBC $hhll,X
+OPCODE(0xFE, inc_absx(cpu))								// INC $hhll,X
+OPCODE(0xFF, bbs(cpu, 7))								// BBS7 $ZZ,$rr
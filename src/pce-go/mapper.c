@@ -0,0 +1,450 @@
+// mapper.c - HuCard mappers (plain ROM, SF2, Populous, Arcade Card)
+//
+#include <stdlib.h>
+#include <string.h>
+#include "pce-go.h"
+#include "pce.h"
+
+
+static uint32_t
+rom_mask(void)
+{
+	uint32_t mask = 1;
+
+	while (mask < PCE.ROM_SIZE)
+		mask <<= 1;
+
+	return mask - 1;
+}
+
+
+/**
+  * Plain ROM: banks $00-$7F mirror the ROM, writes are ignored
+  **/
+static void
+rom_init(void)
+{
+	uint32_t mask = rom_mask();
+
+	for (int i = 0; i < 0x80; i++) {
+		pce_map_rom(i, (i & mask) * 0x2000);
+		PCE.MemoryMapW[i] = PCE.NULLRAM;
+	}
+}
+
+
+/**
+  * 384KB ROMs (and the ones flagged TWO_PART_ROM, Devil Crush 512KB):
+  * a 256KB part seen in banks $00-$1F and $40-$5F, a 128KB part in the
+  * other blocks of 16 banks
+  **/
+static void
+two_part_init(void)
+{
+	uint32_t mask;
+
+	PCE.ROM_SIZE = 0x30;
+	mask = rom_mask();
+
+	for (int i = 0; i < 0x80; i++) {
+		switch (i & 0x70) {
+			case 0x00:
+			case 0x10:
+			case 0x50:
+				pce_map_rom(i, (i & mask) * 0x2000);
+				break;
+			case 0x20:
+			case 0x60:
+			case 0x40:
+				pce_map_rom(i, ((i - 0x20) & mask) * 0x2000);
+				break;
+			case 0x30:
+			case 0x70:
+				pce_map_rom(i, ((i - 0x10) & mask) * 0x2000);
+				break;
+		}
+		PCE.MemoryMapW[i] = PCE.NULLRAM;
+	}
+}
+
+
+/**
+  * Populous: 32KB of RAM on the card, in banks $40-$43. PSRAM builds keep
+  * it in PSRAM, unless there's none and the ROM runs from flash: then it's
+  * in the arena like without PSRAM, the bank cache isn't needed for flash.
+  **/
+#if CARD_ARENA_SIZE < (USE_PSRAM_ROM ? 0x8000 : SRAM_BANK_SLOTS * 0x2000 + 0x8000)
+#error "CARD_ARENA_SIZE has no room for the Populous RAM"
+#endif
+
+static void
+populous_init(void)
+{
+	rom_init();
+
+#if USE_PSRAM_ROM
+	// In PSRAM after the ROM image, used through the bank cache
+	if (!PCE.ROM_DATA) {
+		uint8_t buffer[512] = {0};
+		for (uint32_t pos = 0; pos < 0x8000; pos += sizeof(buffer)) {
+			osd_psram_write(PCE.RAM_STORE + pos, buffer, sizeof(buffer));
+		}
+		for (int i = 0; i < 4; i++) {
+			PCE.MemoryMapR[0x40 + i] = PCE.MemoryMapW[0x40 + i] = NULL;
+			PCE.MemoryHandlerR[0x40 + i] = PCE.MemoryHandlerW[0x40 + i] = MAP_PSRAM;
+			PCE.BankStore[0x40 + i] = PCE.RAM_STORE + i * 0x2000;
+		}
+		return;
+	}
+#endif
+
+	PCE.ExRAM = pce_arena_alloc("ExRAM", 0x8000);
+	if (!PCE.ExRAM)
+		return;
+
+	for (int i = 0; i < 4; i++) {
+		PCE.MemoryMapR[0x40 + i] = PCE.MemoryMapW[0x40 + i] = PCE.ExRAM + i * 0x2000;
+	}
+}
+
+
+/**
+  * Street Fighter 2 mapper, for the ROMs >= 1.5MB: writes to $1FF0-$1FF3
+  * of bank $00 select the 512KB page seen in banks $40-$7F
+  **/
+static void
+sf2_remap(void)
+{
+	pce_bank_cache_drop(0x40, 0x7F, false);
+
+	for (int i = 0x40; i < 0x80; i++) {
+		pce_map_rom(i, PCE.SF2 * 0x80000 + i * 0x2000);
+	}
+
+	// Only the pages showing the switched banks change
+	for (int i = 0; i < 8; i++) {
+		if (PCE.MMR[i] >= 0x40 && PCE.MMR[i] < 0x80)
+			pce_page_refresh(i);
+	}
+}
+
+
+static void
+sf2_init(void)
+{
+	rom_init();
+
+	PCE.MemoryMapW[0x00] = NULL;
+	PCE.MemoryHandlerW[0x00] = MAP_CART;
+}
+
+
+static void
+sf2_write(uint16_t A, uint8_t V)
+{
+	TRACE_IO("Cart Write %02x at %04x\n", V, A);
+
+	if ((A & 0x1FFF) >= 0x1FF0 && PCE.SF2 != (A & 3)) {
+		PCE.SF2 = A & 3;
+		sf2_remap();
+	}
+}
+
+
+#if USE_PSRAM_ROM
+/**
+  * Arcade Card: 2MB of RAM in PSRAM after the ROM, read and written through
+  * 4 ports with an address (base + offset) that moves after each access.
+  * The data of port n is at $1A00 + n * 16 or anywhere in bank $40 + n.
+  * Ports mostly walk the RAM byte by byte: it's read and written through a
+  * direct-mapped cache of lines in SRAM, dirty lines are written back when
+  * they're replaced.
+  *
+  * Its RAM and registers aren't in the save states, they're refused while
+  * it's active.
+  * Without a PSRAM chip (the ROM runs from flash) it's a plain ROM.
+  **/
+#define ARCADE_RAM_SIZE    0x200000
+#define ARCADE_LINE_SIZE   128
+
+static struct {
+	struct {
+		uint32_t base;
+		uint16_t offset;
+		uint16_t increment;
+		uint8_t control;
+	} port[4];
+	uint32_t shift;
+	uint8_t shift_bits;
+	uint8_t rotate_bits;
+} AC;
+
+static const mapper_t rom_mapper;
+
+typedef struct {
+	uint32_t addr;		// RAM address of the line, or ~0
+	bool dirty;
+	uint8_t data[ARCADE_LINE_SIZE];
+} arcade_line_t;
+
+// In the card arena
+static arcade_line_t *arcade_cache;
+
+#if ARCADE_CARD_CACHE_LINES * (ARCADE_LINE_SIZE + 8) > CARD_ARENA_SIZE - SRAM_BANK_SLOTS * 0x2000
+#error "CARD_ARENA_SIZE has no room for the Arcade Card cache"
+#endif
+
+
+static uint8_t *
+arcade_ram(uint32_t addr, bool write)
+{
+	uint32_t line_addr = addr & ~(ARCADE_LINE_SIZE - 1);
+	arcade_line_t *line = &arcade_cache[(addr / ARCADE_LINE_SIZE) % ARCADE_CARD_CACHE_LINES];
+
+	if (line->addr != line_addr) {
+		if (line->dirty)
+			osd_psram_write(PCE.RAM_STORE + line->addr, line->data, ARCADE_LINE_SIZE);
+		osd_psram_read(PCE.RAM_STORE + line_addr, line->data, ARCADE_LINE_SIZE);
+		line->addr = line_addr;
+		line->dirty = false;
+	}
+	line->dirty |= write;
+
+	return &line->data[addr & (ARCADE_LINE_SIZE - 1)];
+}
+
+
+// Control bits: 0 auto-increment, 1 add the offset to the address, 3 the
+// offset is negative, 4 increment the base instead of the offset, 5-6
+// which register write adds the offset to the base
+static uint32_t
+arcade_port_addr(int n)
+{
+	uint32_t addr = AC.port[n].base;
+
+	if (AC.port[n].control & 0x02) {
+		addr += AC.port[n].offset;
+		if (AC.port[n].control & 0x08)
+			addr += 0xFF0000;
+	}
+
+	return addr & (ARCADE_RAM_SIZE - 1);
+}
+
+
+static void
+arcade_port_step(int n)
+{
+	if (!(AC.port[n].control & 0x01))
+		return;
+
+	if (AC.port[n].control & 0x10)
+		AC.port[n].base = (AC.port[n].base + AC.port[n].increment) & 0xFFFFFF;
+	else
+		AC.port[n].offset += AC.port[n].increment;
+}
+
+
+static uint8_t
+arcade_port_read(int n)
+{
+	uint8_t V = *arcade_ram(arcade_port_addr(n), false);
+	arcade_port_step(n);
+	return V;
+}
+
+
+static void
+arcade_port_write(int n, uint8_t V)
+{
+	*arcade_ram(arcade_port_addr(n), true) = V;
+	arcade_port_step(n);
+}
+
+
+static void
+arcade_add_offset(int n)
+{
+	uint32_t offset = AC.port[n].offset;
+
+	if (AC.port[n].control & 0x08)
+		offset |= 0xFF0000;
+
+	AC.port[n].base = (AC.port[n].base + offset) & 0xFFFFFF;
+}
+
+
+static void
+arcade_init(void)
+{
+	rom_init();
+
+	memset(&AC, 0, sizeof(AC));
+
+	arcade_cache = PCE.ROM_DATA ? NULL :
+		pce_arena_alloc("Arcade Card cache", sizeof(arcade_line_t) * ARCADE_CARD_CACHE_LINES);
+	if (!arcade_cache) {
+		// Run it as a plain ROM, without the ports
+		PCE.Mapper = &rom_mapper;
+		return;
+	}
+
+	for (int i = 0; i < ARCADE_CARD_CACHE_LINES; i++) {
+		arcade_cache[i].addr = ~0;
+		arcade_cache[i].dirty = false;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		PCE.MemoryMapR[0x40 + i] = PCE.MemoryMapW[0x40 + i] = NULL;
+		PCE.MemoryHandlerR[0x40 + i] = PCE.MemoryHandlerW[0x40 + i] = MAP_CART;
+	}
+}
+
+
+static uint8_t
+arcade_read(uint16_t A)
+{
+	uint8_t bank = PCE.MMR[A >> 13];
+
+	// Banks $40-$43
+	if (bank != 0xFF)
+		return arcade_port_read(bank & 3);
+
+	int n = (A >> 4) & 3;
+
+	// $1A00-$1A7F, the ports
+	if (!(A & 0x80)) {
+		switch (A & 0xF) {
+		case 0x0:
+		case 0x1: return arcade_port_read(n);
+		case 0x2: return AC.port[n].base;
+		case 0x3: return AC.port[n].base >> 8;
+		case 0x4: return AC.port[n].base >> 16;
+		case 0x5: return AC.port[n].offset;
+		case 0x6: return AC.port[n].offset >> 8;
+		case 0x7: return AC.port[n].increment;
+		case 0x8: return AC.port[n].increment >> 8;
+		case 0x9: return AC.port[n].control;
+		}
+		return 0xFF;
+	}
+
+	// $1AE0-$1AFF, the shift register and the card ID
+	switch (A & 0xFF) {
+	case 0xE0:
+	case 0xE1:
+	case 0xE2:
+	case 0xE3: return AC.shift >> ((A & 3) * 8);
+	case 0xE4: return AC.shift_bits;
+	case 0xE5: return AC.rotate_bits;
+	case 0xFE: return 0x10;
+	case 0xFF: return 0x51;
+	}
+	return 0xFF;
+}
+
+
+static void
+arcade_write(uint16_t A, uint8_t V)
+{
+	uint8_t bank = PCE.MMR[A >> 13];
+
+	TRACE_IO("Arcade Card Write %02x at %04x\n", V, A);
+
+	// Banks $40-$43
+	if (bank != 0xFF) {
+		arcade_port_write(bank & 3, V);
+		return;
+	}
+
+	int n = (A >> 4) & 3;
+
+	// $1A00-$1A7F, the ports
+	if (!(A & 0x80)) {
+		switch (A & 0xF) {
+		case 0x0:
+		case 0x1: arcade_port_write(n, V); break;
+		case 0x2: AC.port[n].base = (AC.port[n].base & ~0xFF) | V; break;
+		case 0x3: AC.port[n].base = (AC.port[n].base & ~0xFF00) | V << 8; break;
+		case 0x4: AC.port[n].base = (AC.port[n].base & ~0xFF0000) | V << 16; break;
+		case 0x5:
+			AC.port[n].offset = (AC.port[n].offset & 0xFF00) | V;
+			if ((AC.port[n].control & 0x60) == 0x20)
+				arcade_add_offset(n);
+			break;
+		case 0x6:
+			AC.port[n].offset = (AC.port[n].offset & 0xFF) | V << 8;
+			if ((AC.port[n].control & 0x60) == 0x40)
+				arcade_add_offset(n);
+			break;
+		case 0x7: AC.port[n].increment = (AC.port[n].increment & 0xFF00) | V; break;
+		case 0x8: AC.port[n].increment = (AC.port[n].increment & 0xFF) | V << 8; break;
+		case 0x9: AC.port[n].control = V & 0x7F; break;
+		case 0xA:
+			if ((AC.port[n].control & 0x60) == 0x60)
+				arcade_add_offset(n);
+			break;
+		}
+		return;
+	}
+
+	// $1AE0-$1AE5, the shift register
+	switch (A & 0xFF) {
+	case 0xE0:
+	case 0xE1:
+	case 0xE2:
+	case 0xE3:
+		AC.shift = (AC.shift & ~(0xFF << ((A & 3) * 8))) | V << ((A & 3) * 8);
+		break;
+	case 0xE4:
+		// Bit 3 set: shift right by 16 - n
+		AC.shift_bits = V & 0xF;
+		if (AC.shift_bits & 0x8)
+			AC.shift >>= 16 - AC.shift_bits;
+		else
+			AC.shift <<= AC.shift_bits;
+		break;
+	case 0xE5:
+		AC.rotate_bits = V & 0xF;
+		if (AC.rotate_bits & 0x8) {
+			int r = 16 - AC.rotate_bits;
+			AC.shift = (AC.shift >> r) | (AC.shift << (32 - r));
+		} else if (AC.rotate_bits) {
+			AC.shift = (AC.shift << AC.rotate_bits) | (AC.shift >> (32 - AC.rotate_bits));
+		}
+		break;
+	}
+}
+#endif
+
+
+static const mapper_t rom_mapper = { "ROM", rom_init, NULL, NULL, NULL };
+static const mapper_t two_part_mapper = { "Two part ROM", two_part_init, NULL, NULL, NULL };
+static const mapper_t populous_mapper = { "Onboard RAM", populous_init, NULL, NULL, NULL };
+static const mapper_t sf2_mapper = { "SF2", sf2_init, NULL, sf2_write, sf2_remap };
+#if USE_PSRAM_ROM
+static const mapper_t arcade_mapper = { "Arcade Card", arcade_init, arcade_read, arcade_write, NULL, true };
+#endif
+
+
+/**
+  * Mapper of a card, from its game database flags and its size in banks
+  **/
+const mapper_t *
+pce_mapper_find(uint32_t flags, uint32_t rom_banks)
+{
+	if (flags & ARCADE_CARD) {
+#if USE_PSRAM_ROM
+		if (!PCE.ROM_DATA)
+			return &arcade_mapper;
+#endif
+		MESSAGE_WARN("No PSRAM for the Arcade Card!\n");
+	}
+	if (flags & ONBOARD_RAM)
+		return &populous_mapper;
+	if ((flags & SF2_MAPPER) || rom_banks >= 192)
+		return &sf2_mapper;
+	if ((flags & TWO_PART_ROM) || rom_banks == 0x30)
+		return &two_part_mapper;
+	return &rom_mapper;
+}
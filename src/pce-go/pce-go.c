@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
 #include "pce-go.h"
 #include "gfx.h"
@@ -31,7 +32,10 @@ typedef const struct {
     void *ptr;
 } save_var_t;
 
-static const char SAVESTATE_HEADER[8] = "PCE_V010";
+static const char SAVESTATE_HEADER[8] = "PCE_V011";
+// Before the timer ran from event to event: TMR.next was the countdown to the
+// next tick, decremented by a line at the end of each line
+static const char SAVESTATE_HEADER_V010[8] = "PCE_V010";
 static save_var_t SaveStateVars[] =
         {
                 // Arrays
@@ -74,29 +78,187 @@ static save_var_t SaveStateVars[] =
                 SVAR_END
         };
 
-#define TWO_PART_ROM 0x0001
-#define ONBOARD_RAM  0x0100
-#define US_ENCODED   0x0010
-
-static const struct {
-    const uint32_t CRC;
-    const char *Name;
-    const uint32_t Flags;
-} romFlags[] = {
-        { 0xF0ED3094, "Blazing Lazers",       TWO_PART_ROM },
-        { 0xB4A1B0F6, "Blazing Lazers",       TWO_PART_ROM },
-        { 0x55E9630D, "Legend of Hero Tonma", US_ENCODED },
-        { 0x083C956A, "Populous",             ONBOARD_RAM },
-        { 0x0A9ADE99, "Populous",             ONBOARD_RAM },
-        { 0x00000000, "Unknown", 0 },
+// Known games, sorted by CRC for FindGame. LoadGameDB adds to (and
+// overrides) these from a file.
+static const game_info_t GameDB[] = {
+        { 0x083C956A, ONBOARD_RAM,  "Populous" },
+        { 0x0A9ADE99, ONBOARD_RAM,  "Populous" },
+        { 0x55E9630D, US_ENCODED,   "Legend of Hero Tonma" },
+        { 0xB4A1B0F6, TWO_PART_ROM, "Blazing Lazers" },
+        { 0xF0ED3094, TWO_PART_ROM, "Blazing Lazers" },
 };
 
+#define GAME_DB_EXTRA 32
+
+static game_info_t GameDBExtra[GAME_DB_EXTRA];
+static char GameDBNames[GAME_DB_EXTRA][32];
+static int GameDBExtraCount = 0;
+
 static bool running = false;
 
 /**
- * Load card into memory and set its memory map
+ * US encoded HuCards have the bits of each byte reversed
+ */
+const uint8_t US_DECODE[256] = {
+        0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
+        0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8,
+        0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+        0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC, 0x3C, 0xBC, 0x7C, 0xFC,
+        0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2, 0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2,
+        0x0A, 0x8A, 0x4A, 0xCA, 0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+        0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6, 0x36, 0xB6, 0x76, 0xF6,
+        0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE, 0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE,
+        0x01, 0x81, 0x41, 0xC1, 0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+        0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9, 0x39, 0xB9, 0x79, 0xF9,
+        0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5, 0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5,
+        0x0D, 0x8D, 0x4D, 0xCD, 0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+        0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3, 0x33, 0xB3, 0x73, 0xF3,
+        0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB, 0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB,
+        0x07, 0x87, 0x47, 0xC7, 0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+        0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF,
+};
+
+/**
+ * Decode US encoded ROM data in place
+ */
+void
+DecodeUS(uint8_t *data, size_t len) {
+    for (size_t x = 0; x < len; x++) {
+        data[x] = US_DECODE[data[x]];
+    }
+}
+
+/**
+ * CRC-32 (IEEE) of the ROM files, slice-by-8 or a byte at a time
+ */
+#ifndef RETRO_GO
+#define CRC32_TABLES (USE_CRC32_SLICE8 ? 8 : 1)
+
+static uint32_t crc32_table[CRC32_TABLES][256];
+
+uint32_t
+crc32_le(uint32_t crc, const uint8_t *buf, size_t len) {
+    if (!crc32_table[0][1]) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c >> 1) ^ (c & 1 ? 0xEDB88320 : 0);
+            crc32_table[0][i] = c;
+        }
+        for (int t = 1; t < CRC32_TABLES; t++) {
+            for (int i = 0; i < 256; i++)
+                crc32_table[t][i] = (crc32_table[t - 1][i] >> 8) ^ crc32_table[0][crc32_table[t - 1][i] & 0xFF];
+        }
+    }
+
+    crc = ~crc;
+#if USE_CRC32_SLICE8
+    for (; len >= 8; len -= 8, buf += 8) {
+        uint32_t lo = crc ^ (buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t)buf[3] << 24);
+        uint32_t hi = buf[4] | buf[5] << 8 | buf[6] << 16 | (uint32_t)buf[7] << 24;
+        crc = crc32_table[7][lo & 0xFF] ^ crc32_table[6][(lo >> 8) & 0xFF]
+            ^ crc32_table[5][(lo >> 16) & 0xFF] ^ crc32_table[4][lo >> 24]
+            ^ crc32_table[3][hi & 0xFF] ^ crc32_table[2][(hi >> 8) & 0xFF]
+            ^ crc32_table[1][(hi >> 16) & 0xFF] ^ crc32_table[0][hi >> 24];
+    }
+#endif
+    while (len--)
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *buf++) & 0xFF];
+    return ~crc;
+}
+#endif
+
+static int
+CompareGame(const void *key, const void *entry) {
+    uint32_t crc = *(const uint32_t *)key, other = ((const game_info_t *)entry)->CRC;
+    return crc < other ? -1 : crc > other;
+}
+
+/**
+ * Look a ROM up by CRC, in the games added by LoadGameDB first
+ */
+const game_info_t *
+FindGame(uint32_t crc) {
+    const game_info_t *game = bsearch(&crc, GameDBExtra, GameDBExtraCount, sizeof(game_info_t), CompareGame);
+    if (!game)
+        game = bsearch(&crc, GameDB, sizeof(GameDB) / sizeof(GameDB[0]), sizeof(game_info_t), CompareGame);
+    return game;
+}
+
+/**
+ * Add games from a text file, one per line: CRC and flags in hex, then the
+ * name. Lines starting with # are comments. Returns the number of games.
+ */
+int
+LoadGameDB(const char *name) {
+    FIL fp;
+    if (f_open(&fp, name, FA_READ) != FR_OK)
+        return -1;
+
+    char buffer[256], line[80];
+    size_t len = 0;
+    unsigned int br = 0;
+
+    GameDBExtraCount = 0;
+
+    do {
+        if (f_read(&fp, buffer, sizeof(buffer), &br) != FR_OK)
+            br = 0;
+
+        for (unsigned int i = 0; i <= br; i++) {
+            // A missing newline at the end of the file ends the last line
+            if (i < br && buffer[i] != '\n' && buffer[i] != '\r') {
+                if (len < sizeof(line) - 1)
+                    line[len++] = buffer[i];
+                continue;
+            }
+            if (i == br && br)
+                break;
+            line[len] = 0;
+            len = 0;
+
+            unsigned long crc, flags;
+            int name_pos = 0;
+            if (line[0] == '#' || sscanf(line, "%lx %lx %n", &crc, &flags, &name_pos) < 2 || !name_pos)
+                continue;
+            if (GameDBExtraCount == GAME_DB_EXTRA) {
+                MESSAGE_WARN("Game database full, %s ignored\n", line + name_pos);
+                continue;
+            }
+
+            // Sorted insertion, a CRC listed twice keeps the last line
+            int pos = GameDBExtraCount;
+            while (pos > 0 && GameDBExtra[pos - 1].CRC > crc)
+                pos--;
+            if (pos > 0 && GameDBExtra[pos - 1].CRC == crc) {
+                pos--;
+            } else {
+                for (int j = GameDBExtraCount; j > pos; j--) {
+                    GameDBExtra[j] = GameDBExtra[j - 1];
+                    GameDBExtra[j].Name = GameDBNames[j];
+                    memcpy(GameDBNames[j], GameDBNames[j - 1], sizeof(GameDBNames[j]));
+                }
+                GameDBExtraCount++;
+            }
+            snprintf(GameDBNames[pos], sizeof(GameDBNames[pos]), "%s", line + name_pos);
+            GameDBExtra[pos] = (game_info_t) { crc, flags, GameDBNames[pos] };
+        }
+    } while (br);
+
+    f_close(&fp);
+
+    MESSAGE_INFO("Loaded %d games from %s\n", GameDBExtraCount, name);
+    return GameDBExtraCount;
+}
+
+/**
+ * Load card into memory and set its memory map. ROM is NULL when the
+ * image was copied to PSRAM address 0 (USE_PSRAM_ROM). crc is the CRC-32 of
+ * the file when the loader computed it, 0 to compute it here. decoded is
+ * set when the loader already dealt with US encoded images, the image may
+ * then be read-only.
  */
-int LoadCard(const char *ROM, size_t fsize) {
+int LoadCard(const char *ROM, size_t fsize, uint32_t crc, bool decoded) {
     int offset;
 #if 0
 
@@ -122,12 +284,16 @@ int LoadCard(const char *ROM, size_t fsize) {
     offset = fsize & 0x1fff;
 
     // read ROM
-    PCE.ROM = ROM;
+    PCE.ROM = (const uint8_t *)ROM;
 
+#if USE_PSRAM_ROM
+    PCE.ROM_STORE = offset;
+#else
     if (PCE.ROM == NULL) {
         MESSAGE_ERROR("Failed to allocate ROM buffer!\n");
         return -1;
     }
+#endif
 /*
 	fseek(fp, 0, SEEK_SET);
 	fread(PCE.ROM, 1, fsize, fp);
@@ -135,90 +301,74 @@ int LoadCard(const char *ROM, size_t fsize) {
 	fclose(fp);
 */
     PCE.ROM_SIZE = (fsize - offset) / 0x2000;
-    PCE.ROM_DATA = (uint8_t*)PCE.ROM + offset;
-    PCE.ROM_CRC = crc32_le(0, PCE.ROM, fsize);
+    PCE.ROM_DATA = PCE.ROM ? (uint8_t*)PCE.ROM + offset : NULL;
+    PCE.ROM_CRC = crc;
 
-    uint32_t IDX = 0;
-    uint32_t ROM_MASK = 1;
+    if (!crc && PCE.ROM) {
+        PCE.ROM_CRC = crc32_le(0, (const uint8_t *)PCE.ROM, fsize);
+    }
+#if USE_PSRAM_ROM
+    else if (!crc) {
+        uint8_t buffer[512];
+        for (uint32_t pos = 0; pos < fsize; pos += sizeof(buffer)) {
+            size_t len = MIN(sizeof(buffer), fsize - pos);
+            osd_psram_read(pos, buffer, len);
+            PCE.ROM_CRC = crc32_le(PCE.ROM_CRC, buffer, len);
+        }
+    }
+#endif
 
-    while (ROM_MASK < PCE.ROM_SIZE) ROM_MASK <<= 1;
-    ROM_MASK--;
+    MESSAGE_INFO("ROM LOADED: OFFSET=%d, BANKS=%d, CRC=%08X\n",
+                 offset, PCE.ROM_SIZE, PCE.ROM_CRC);
 
-    MESSAGE_INFO("ROM LOADED: OFFSET=%d, BANKS=%d, MASK=%03X, CRC=%08X\n",
-                 offset, PCE.ROM_SIZE, ROM_MASK, PCE.ROM_CRC);
+    const game_info_t *game = FindGame(PCE.ROM_CRC);
+    uint32_t flags = game ? game->Flags : 0;
 
-    while (romFlags[IDX].CRC) {
-        if (PCE.ROM_CRC == romFlags[IDX].CRC)
-            break;
-        IDX++;
-    }
+    MESSAGE_INFO("Game Name: %s\n", game ? game->Name : "Unknown");
 
-    MESSAGE_INFO("Game Name: %s\n", romFlags[IDX].Name);
+    // US Encrypted. The pico loader decodes them while copying them to flash
+    // or PSRAM (and passes decoded), this is for the images loaded to a
+    // writable buffer.
+    uint8_t reset_msb;
+#if USE_PSRAM_ROM
+    if (!PCE.ROM_DATA)
+        osd_psram_read(PCE.ROM_STORE + 0x1FFF, &reset_msb, 1);
+    else
+#endif
+    reset_msb = PCE.ROM_DATA[0x1FFF];
 
-    // US Encrypted
-    if ((romFlags[IDX].Flags & US_ENCODED) || PCE.ROM_DATA[0x1FFF] < 0xE0) {
+    if (!decoded && ((flags & US_ENCODED) || IS_US_ENCODED(reset_msb))) {
         MESSAGE_INFO("This rom is probably US encrypted, decrypting...\n");
 
-        unsigned char inverted_nibble[16] = {
-                0, 8, 4, 12, 2, 10, 6, 14,
-                1, 9, 5, 13, 3, 11, 7, 15
-        };
+#if USE_PSRAM_ROM
+        if (!PCE.ROM_DATA) {
+            uint8_t buffer[512];
+            for (uint32_t pos = 0; pos < PCE.ROM_SIZE * 0x2000; pos += sizeof(buffer)) {
+                osd_psram_read(PCE.ROM_STORE + pos, buffer, sizeof(buffer));
+                DecodeUS(buffer, sizeof(buffer));
+                osd_psram_write(PCE.ROM_STORE + pos, buffer, sizeof(buffer));
+            }
+        } else
+#endif
+        DecodeUS(PCE.ROM_DATA, PCE.ROM_SIZE * 0x2000);
+    }
 
-        for (int x = 0; x < PCE.ROM_SIZE * 0x2000; x++) {
-            unsigned char temp = PCE.ROM_DATA[x] & 15;
+    // Games whose timing breaks when the CPU skips idle loops
+    PCE.IdleSkip = !(flags & NO_IDLE_SKIP);
 
-            PCE.ROM_DATA[x] &= ~0x0F;
-            PCE.ROM_DATA[x] |= inverted_nibble[PCE.ROM_DATA[x] >> 4];
+#if USE_PSRAM_ROM
+    PCE.RAM_STORE = (fsize + 0x1FFF) & ~0x1FFF;
+#endif
 
-            PCE.ROM_DATA[x] &= ~0xF0;
-            PCE.ROM_DATA[x] |= inverted_nibble[temp] << 4;
-        }
-    }
+    // The mapper takes the card RAM from the arena, the bank cache the rest
+    pce_arena_reset();
 
-    // For example with Devil Crush 512Ko
-    if (romFlags[IDX].Flags & TWO_PART_ROM)
-        PCE.ROM_SIZE = 0x30;
-
-    // Game ROM
-    for (int i = 0; i < 0x80; i++) {
-        if (PCE.ROM_SIZE == 0x30) {
-            switch (i & 0x70) {
-                case 0x00:
-                case 0x10:
-                case 0x50:
-                    PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
-                    break;
-                case 0x20:
-                case 0x60:
-                    PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
-                    break;
-                case 0x30:
-                case 0x70:
-                    PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x10) & ROM_MASK) * 0x2000;
-                    break;
-                case 0x40:
-                    PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
-                    break;
-            }
-        } else {
-            PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
-        }
-        PCE.MemoryMapW[i] = PCE.NULLRAM;
-    }
+    PCE.Mapper = pce_mapper_find(flags, PCE.ROM_SIZE);
+    PCE.Mapper->init();
 
-    // Allocate the card's onboard ram
-    if (romFlags[IDX].Flags & ONBOARD_RAM) {
-        // if (!PCE.ExRAM)
-        // PCE.ExRAM = malloc(0x8000);
-        PCE.MemoryMapR[0x40] = PCE.MemoryMapW[0x40] = PCE.ExRAM;
-        PCE.MemoryMapR[0x41] = PCE.MemoryMapW[0x41] = PCE.ExRAM + 0x2000;
-        PCE.MemoryMapR[0x42] = PCE.MemoryMapW[0x42] = PCE.ExRAM + 0x4000;
-        PCE.MemoryMapR[0x43] = PCE.MemoryMapW[0x43] = PCE.ExRAM + 0x6000;
-    }
+    MESSAGE_INFO("Mapper: %s\n", PCE.Mapper->name);
 
-    // Mapper for roms >= 1.5MB (SF2, homebrews)
-    if (PCE.ROM_SIZE >= 192)
-        PCE.MemoryMapW[0x00] = PCE.IOAREA;
+    pce_arena_commit();
 
     return 0;
 }
@@ -238,7 +388,7 @@ ResetPCE(bool hard) {
  * Initialize the emulator (allocate memory, call osd_init* functions)
  */
 int
-InitPCE(int samplerate, bool stereo, const void *ROM, size_t fsize) {
+InitPCE(int samplerate, bool stereo, const void *ROM, size_t fsize, uint32_t crc, bool decoded) {
     if (gfx_init())
         return 1;
 
@@ -248,7 +398,7 @@ InitPCE(int samplerate, bool stereo, const void *ROM, size_t fsize) {
     if (pce_init())
         return 1;
 
-    if (ROM && LoadCard(ROM, fsize))
+    if ((ROM || fsize) && LoadCard(ROM, fsize, crc, decoded))
         return 1;
 
     ResetPCE(0);
@@ -320,6 +470,14 @@ int LoadState(const char *name) {
 
     MESSAGE_INFO("Loading state from %s...\n", name);
 
+    if (PCE.Mapper && PCE.Mapper->no_state) {
+        MESSAGE_ERROR("Loading state failed: %s not supported\n", PCE.Mapper->name);
+        return -1;
+    }
+
+    // VRAM is about to be replaced
+    pce_render_fence();
+
     char buffer[32];
     block_hdr_t block;
     int ret = -1;
@@ -329,7 +487,12 @@ int LoadState(const char *name) {
     if (f_open(&fp, name, FA_READ) != FR_OK)
         return -1;
 
-    if (FR_OK != f_read(&fp, &buffer, 8, &br) || !br || memcmp(&buffer, SAVESTATE_HEADER, 8) != 0) {
+    if (FR_OK != f_read(&fp, &buffer, 8, &br) || !br) {
+        MESSAGE_ERROR("Loading state failed: Header mismatch\n");
+        goto _cleanup;
+    }
+    bool v010 = memcmp(&buffer, SAVESTATE_HEADER_V010, 8) == 0;
+    if (!v010 && memcmp(&buffer, SAVESTATE_HEADER, 8) != 0) {
         MESSAGE_ERROR("Loading state failed: Header mismatch\n");
         goto _cleanup;
     }
@@ -356,6 +519,16 @@ int LoadState(const char *name) {
         f_lseek(&fp, block_end);
     }
 
+    // States are saved at the start of a line, where the old countdown is
+    // the timestamp of the next tick. It was only checked at the end of a
+    // line: a tick it had gone past is due right away.
+    if (v010) {
+        PCE.Timer.cycles_counter = MIN(MAX(PCE.Timer.cycles_counter, 0), CYCLES_PER_TIMER_TICK);
+    }
+
+    if (PCE.Mapper && PCE.Mapper->remap)
+        PCE.Mapper->remap();
+
     for (int i = 0; i < 8; i++)
         pce_bank_set(i, PCE.MMR[i]);
 
@@ -377,6 +550,11 @@ int
 SaveState(const char *name) {
     MESSAGE_INFO("Saving state to %s...\n", name);
 
+    if (PCE.Mapper && PCE.Mapper->no_state) {
+        MESSAGE_ERROR("Saving state failed: %s not supported\n", PCE.Mapper->name);
+        return -1;
+    }
+
     int ret = -1;
     unsigned int bw = 0;
 
@@ -409,6 +587,98 @@ SaveState(const char *name) {
 }
 
 
+#if ENABLE_PROFILER
+static const char *const io_regions[8] = {
+    "VDC", "VCE", "PSG", "Timer", "Joypad", "IRQ", "CD-ROM", "Mapper"
+};
+
+static void
+profile_printf(FIL *fp, const char *fmt, ...)
+{
+    char line[96];
+    unsigned int bw;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    f_write(fp, line, MIN(len, (int)sizeof(line) - 1), &bw);
+}
+
+
+/**
+ * Write the profiler counters as a text report
+ */
+int
+SaveProfile(const char *name) {
+    MESSAGE_INFO("Saving profile to %s...\n", name);
+
+    FIL fp;
+    if (f_open(&fp, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+        return -1;
+
+    uint64_t insns = 0, cycles = 0;
+    for (int i = 0; i < 256; i++) {
+        insns += Profile.insns[i];
+        cycles += Profile.cycles[i];
+    }
+    profile_printf(&fp, "instructions %llu, cycles %llu\n",
+                   (unsigned long long)insns, (unsigned long long)cycles);
+    profile_printf(&fp, "rom instructions %lu, %.2f%% from the SRAM bank cache (%d slots)\n",
+                   (unsigned long)Profile.rom_insns,
+                   Profile.rom_insns ? Profile.sram_insns * 100.0 / Profile.rom_insns : 0.0, (int)PCE.BankSlots);
+
+    // Opcodes by cycles spent, the hottest first
+    uint8_t order[256];
+    for (int i = 0; i < 256; i++)
+        order[i] = i;
+    for (int i = 1; i < 256; i++) {
+        for (int j = i; j > 0 && Profile.cycles[order[j]] > Profile.cycles[order[j - 1]]; j--) {
+            uint8_t t = order[j]; order[j] = order[j - 1]; order[j - 1] = t;
+        }
+    }
+
+    profile_printf(&fp, "\n[opcodes]\nop  name  instructions cycles\n");
+    for (int i = 0; i < 256 && Profile.insns[order[i]]; i++) {
+        uint8_t op = order[i];
+        profile_printf(&fp, "%02X  %-5s %12lu %12lu %5.2f%%\n", op, h6280_opcode_name(op),
+                       (unsigned long)Profile.insns[op], (unsigned long)Profile.cycles[op],
+                       cycles ? Profile.cycles[op] * 100.0 / cycles : 0.0);
+    }
+
+    // PC histogram, bank:offset of each 256-byte page that ran code
+    profile_printf(&fp, "\n[pages]\nbank:page    instructions\n");
+    for (int bank = 0; bank < 256; bank++) {
+        for (int page = 0; page < 32; page++) {
+            uint32_t count = Profile.pages[bank][page];
+            if (count)
+                profile_printf(&fp, "%02X:%04X %16lu %5.2f%%\n", bank, page << 8,
+                               (unsigned long)count, count * 100.0 / insns);
+        }
+    }
+
+    profile_printf(&fp, "\n[io]\nregion           reads       writes\n");
+    for (int i = 0; i < 32; i++) {
+        if (Profile.io_reads[i] || Profile.io_writes[i])
+            profile_printf(&fp, "%04X %-7s %12lu %12lu\n", i << 8, io_regions[i >> 2],
+                           (unsigned long)Profile.io_reads[i], (unsigned long)Profile.io_writes[i]);
+    }
+
+    f_close(&fp);
+
+    return 0;
+}
+
+
+/**
+ * Clear the profiler counters
+ */
+void
+ResetProfile() {
+    memset(&Profile, 0, sizeof(Profile));
+}
+#endif
+
+
 /**
  * Cleanup and quit (not used in retro-go)
  */
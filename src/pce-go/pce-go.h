@@ -17,7 +17,7 @@
 //#define LOG_PRINTF(level, x...) printf(x)
 #define LOG_PRINTF(level, x...) {}
 #define IRAM_ATTR __always_inline
-#define crc32_le(a, b, c) (0)
+uint32_t crc32_le(uint32_t crc, const uint8_t *buf, size_t len);
 #endif
 
 #define MESSAGE_ERROR(x...) LOG_PRINTF(1, "!! " x)
@@ -54,6 +54,36 @@
 #define TRACE_CPU(x...) {}
 #endif
 
+// Subsystems timed by the host benchmark (bench/pce-bench.c)
+#define BENCH_CPU   0
+#define BENCH_GFX   1
+#define BENCH_PSG   2
+#define BENCH_MAX   3
+
+// Event counters reported by the host benchmark
+#define BENCH_STAT_INSNS   0
+#define BENCH_STAT_MAX     1
+
+#if ENABLE_BENCH_TIMING
+extern void osd_bench_begin(int slot);
+extern void osd_bench_end(int slot);
+extern void osd_bench_stat(int stat, uint32_t count);
+#define BENCH_BEGIN(slot) osd_bench_begin(slot)
+#define BENCH_END(slot) osd_bench_end(slot)
+#define BENCH_STAT(stat, count) osd_bench_stat(stat, count)
+#else
+#define BENCH_BEGIN(slot) {}
+#define BENCH_END(slot) {}
+#define BENCH_STAT(stat, count) {}
+#endif
+
+#if ENABLE_BENCH_PAIRS
+extern void osd_bench_pair(uint8_t first, uint8_t second);
+#define BENCH_PAIR(first, second) osd_bench_pair(first, second)
+#else
+#define BENCH_PAIR(first, second) {}
+#endif
+
 #undef MIN
 #define MIN(a,b) ({__typeof__(a) _a = (a); __typeof__(b) _b = (b);_a < _b ? _a : _b; })
 #undef MAX
@@ -75,14 +105,45 @@
 
 int LoadState(const char *name);
 int SaveState(const char *name);
+int SaveProfile(const char *name);
+void ResetProfile();
 void ResetPCE(bool);
 void RunPCE(void);
 void ShutdownPCE();
-int InitPCE(int samplerate, bool stereo, const void *ROM, size_t fsize);
+int InitPCE(int samplerate, bool stereo, const void *ROM, size_t fsize, uint32_t crc, bool decoded);
 // int LoadCard(const char *name);
-int LoadCard(const char *ROM, size_t size);
+int LoadCard(const char *ROM, size_t size, uint32_t crc, bool decoded);
 void *PalettePCE(int bitdepth);
+void DecodeUS(uint8_t *data, size_t len);
+
+// Game database flags
+#define TWO_PART_ROM 0x0001
+#define US_ENCODED   0x0010
+#define ONBOARD_RAM  0x0100
+#define SF2_MAPPER   0x0200
+#define ARCADE_CARD  0x0400
+#define NO_IDLE_SKIP 0x1000
+
+typedef struct {
+    uint32_t CRC;
+    uint32_t Flags;
+    const char *Name;
+} game_info_t;
+
+const game_info_t *FindGame(uint32_t crc);
+int LoadGameDB(const char *name);
+
+// Card RAM kept in PSRAM after the ROM (USE_PSRAM_ROM), the Arcade Card's
+#define PSRAM_CARD_RAM_SIZE 0x200000
+
+// US encoded ROMs are detected by the reset vector MSB, at $1FFF in the first bank
+extern const uint8_t US_DECODE[256];
+#define IS_US_ENCODED(reset_msb) ((reset_msb) < 0xE0)
 
 extern uint8_t *osd_gfx_framebuffer(int width, int height);
 extern void osd_input_read(uint8_t joypads[8]);
 extern void osd_vsync(void);
+#if USE_PSRAM_ROM
+extern void osd_psram_read(uint32_t addr, void *dst, size_t len);
+extern void osd_psram_write(uint32_t addr, const void *src, size_t len);
+#endif
@@ -3,6 +3,7 @@
 //
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 #include "pce-go.h"
 #include "pce.h"
 #include "gfx.h"
@@ -14,7 +15,14 @@ PCE_t PCE;
 uint8_t *PageR[8];
 uint8_t *PageW[8];
 
-static inline void timer_run(int cycles);
+#if ENABLE_PROFILER
+pce_profile_t Profile;
+#endif
+
+uint8_t CardArena[CARD_ARENA_SIZE] __attribute__((aligned(8)));
+
+static inline void timer_run(void);
+static void bank_cache_update(void);
 
 /**
   * Reset the hardware
@@ -22,6 +30,9 @@ static inline void timer_run(int cycles);
 void
 pce_reset(bool hard)
 {
+	// The render core may still be drawing from VRAM and the palette
+	pce_render_fence();
+
 	memset(&PCE.VCE, 0, sizeof(PCE.VCE));
 	memset(&PCE.VDC, 0, sizeof(PCE.VDC));
 	memset(&PCE.PSG, 0, sizeof(PCE.PSG));
@@ -42,6 +53,12 @@ pce_reset(bool hard)
 	PCE.Timer.cycles_per_line = 113;
 	PCE.Cycles = 0;
 
+	// The ROM may have been reloaded, banks are copied again as they get used
+	pce_bank_cache_drop(0x00, 0xFF, true);
+
+	if (PCE.Mapper && PCE.Mapper->remap)
+		PCE.Mapper->remap();
+
 	// Reset sound generator values
 	for (int i = 0; i < PSG_CHANNELS; i++) {
 		PCE.PSG.chan[i].control = 0x80;
@@ -74,15 +91,9 @@ pce_init(void)
 	// PCE.RAM = malloc(0x2000);
 	// PCE.VRAM = malloc(0x10000);
 	// PCE.NULLRAM = malloc(0x2000);
-	PCE.IOAREA = PCE.NULLRAM + 4;
 	// PCE.MemoryMapR = calloc(256, sizeof(uint8_t *));
 	// PCE.MemoryMapW = calloc(256, sizeof(uint8_t *));
 
-	if (!PCE.RAM || !PCE.VRAM || !PCE.NULLRAM || !PCE.MemoryMapR || !PCE.MemoryMapW) {
-		pce_term();
-		return -1;
-	}
-
 	for (int i = 0; i < 0xFF; i++) {
 		PCE.MemoryMapR[i] = PCE.NULLRAM;
 		PCE.MemoryMapW[i] = PCE.NULLRAM;
@@ -90,8 +101,11 @@ pce_init(void)
 
 	PCE.MemoryMapR[0xF8] = PCE.RAM;
 	PCE.MemoryMapW[0xF8] = PCE.RAM;
-	PCE.MemoryMapR[0xFF] = PCE.IOAREA;
-	PCE.MemoryMapW[0xFF] = PCE.IOAREA;
+	// The hardware page goes through the IO handlers
+	PCE.MemoryMapR[0xFF] = NULL;
+	PCE.MemoryMapW[0xFF] = NULL;
+	PCE.MemoryHandlerR[0xFF] = MAP_IO;
+	PCE.MemoryHandlerW[0xFF] = MAP_IO;
 
 	// pce_reset();
 
@@ -137,552 +151,1095 @@ pce_run(void)
 	// Emulate!
 	for (PCE.Scanline = 0; PCE.Scanline < 263; ++PCE.Scanline) {
 		PCE.MaxCycles += PCE.Timer.cycles_per_line;
-		/*while (PCE.MaxCycles > 0) */ {
-			h6280_run(PCE.MaxCycles);
-			timer_run(PCE.Cycles);
-			PCE.MaxCycles -= PCE.Cycles;
-			PCE.Cycles = 0;
+		// Run the CPU from event to event until the end of the line
+		while (PCE.Cycles < PCE.MaxCycles) {
+			pce_schedule();
+			BENCH_BEGIN(BENCH_CPU);
+			h6280_run(PCE.NextEvent);
+			BENCH_END(BENCH_CPU);
+			timer_run();
 		}
+		// Cycle timestamps are relative to the start of the line
+		if (PCE.Timer.running) {
+			PCE.Timer.cycles_counter -= PCE.Cycles;
+		}
+		PCE.MaxCycles -= PCE.Cycles;
+		PCE.Cycles = 0;
+		BENCH_BEGIN(BENCH_GFX);
 		gfx_run();
+		BENCH_END(BENCH_GFX);
 	}
+
+	bank_cache_update();
 }
 
 
 /**
- * Functions to access PCE hardware
- **/
-
-static inline void
-timer_run(int cycles)
+  * Compute the end of the next CPU slice: the end of the line, the next
+  * timer tick or right away if an interrupt can be taken.
+  * Called between slices and by the IO handlers that may raise an IRQ.
+  **/
+void
+pce_schedule(void)
 {
-	PCE.Timer.cycles_counter -= PCE.Timer.cycles_per_line;
+	int32_t next = PCE.MaxCycles;
 
-	if (PCE.Timer.cycles_counter < 0) {
-		PCE.Timer.cycles_counter += CYCLES_PER_TIMER_TICK;
-		if (PCE.Timer.running) {
-			// Trigger when it underflows from 0
-			if (PCE.Timer.counter > 0x7F) {
-				PCE.Timer.counter = PCE.Timer.reload;
-				CPU.irq_lines |= INT_TIMER;
-			}
-			PCE.Timer.counter--;
-		}
+	if (PCE.Timer.running && PCE.Timer.cycles_counter < next) {
+		next = PCE.Timer.cycles_counter;
 	}
+
+	// Let h6280_run take the interrupt and execute at least one instruction
+	if (!(CPU.P & FL_I) && (CPU.irq_lines & ~CPU.irq_mask & INT_MASK)) {
+		next = PCE.Cycles + 1;
+	}
+
+	PCE.NextEvent = next;
 }
 
 
-static inline void
-cart_write(uint16_t A, uint8_t V)
+/**
+  * SRAM bank cache: ROM banks live in flash (XIP), every access missing the
+  * XIP cache stalls on QSPI. The hottest ROM banks are copied to 8KB slots
+  * of SRAM and their MemoryMapR entry (and PageR) points at the copy. A
+  * bank heats up when it's mapped and when code runs from its flash copy,
+  * and cools down by half every frame. At the end of the frame the hottest
+  * bank still in flash takes a free slot or the least recently used one.
+  * The slots are the part of the card arena the card RAM doesn't use.
+  *
+  * Banks in PSRAM (USE_PSRAM_ROM) can't be used in place at all: they're
+  * copied to a slot by pce_bank_set as soon as they're mapped, evicting the
+  * least recently used bank that isn't mapped. Card RAM banks are written
+  * back to PSRAM when they leave their slot. A freed slot keeps its PSRAM
+  * address so the SF2 mapper switching back to a page finds its banks.
+  **/
+#if SRAM_BANK_SLOTS
+
+#if USE_PSRAM_ROM && SRAM_BANK_SLOTS < 8
+#error "USE_PSRAM_ROM needs a bank cache slot for each of the 8 pages"
+#endif
+
+#define BANK_HEAT_MIN          64	// Heat needed to be copied to SRAM
+#define BANK_SLOTS_MAX         (CARD_ARENA_SIZE / 0x2000)
+
+enum {
+	SLOT_FREE = 0,
+	SLOT_FLASH,			// Copy of a ROM bank in flash
+	SLOT_PSRAM,			// ROM bank loaded from PSRAM
+	SLOT_PSRAM_RW,		// Card RAM bank loaded from PSRAM
+};
+
+static struct {
+	uint8_t *rom;		// Flash copy of the bank (SLOT_FLASH)
+	uint32_t store;		// PSRAM copy of the slot contents, or ~0
+	uint8_t bank;
+	uint8_t state;
+	uint32_t used;		// Last frame the bank was mapped or hot, for LRU
+} bank_slots[BANK_SLOTS_MAX];
+
+static uint32_t bank_frame;
+
+
+static void
+bank_remap(int bank)
 {
-	TRACE_IO("Cart Write %02x at %04x\n", V, A);
+	for (int i = 0; i < 8; i++) {
+		if (PCE.MMR[i] == bank)
+			pce_bank_set(i, bank);
+	}
+}
 
-	// SF2 Mapper
-	if (A >= 0xFFF0 && PCE.ROM_SIZE >= 0xC0)
-	{
-		if (PCE.SF2 != (A & 3))
-		{
-			PCE.SF2 = A & 3;
-			uint8_t *base = PCE.ROM_DATA + PCE.SF2 * (512 * 1024);
-			for (int i = 0x40; i < 0x80; i++)
-			{
-				PCE.MemoryMapR[i] = base + i * 0x2000;
-			}
-			for (int i = 0; i < 8; i++)
-			{
-				if (PCE.MMR[i] >= 0x40 && PCE.MMR[i] < 0x80)
-					pce_bank_set(i, PCE.MMR[i]);
-			}
+
+// Frees a slot. Flash banks go back to their flash copy if restore is set,
+// PSRAM banks go back behind MAP_PSRAM and the caller remaps their pages.
+static void
+bank_slot_release(int slot, bool restore)
+{
+	int bank = bank_slots[slot].bank;
+
+	if (bank_slots[slot].state == SLOT_FLASH) {
+		if (restore && PCE.MemoryMapR[bank] == BankCache[slot]) {
+			PCE.MemoryMapR[bank] = bank_slots[slot].rom;
+			bank_remap(bank);
+		}
+	}
+#if USE_PSRAM_ROM
+	else if (bank_slots[slot].state != SLOT_FREE && PCE.MemoryMapR[bank] == BankCache[slot]) {
+		if (bank_slots[slot].state == SLOT_PSRAM_RW) {
+			osd_psram_write(PCE.BankStore[bank], BankCache[slot], 0x2000);
+			PCE.MemoryMapW[bank] = NULL;
 		}
+		PCE.MemoryMapR[bank] = NULL;
 	}
+#endif
+	bank_slots[slot].state = SLOT_FREE;
 }
 
 
-inline uint8_t
-pce_readIO(uint16_t A)
+void
+pce_bank_cache_drop(int first, int last, bool restore)
 {
-	uint8_t ret = 0xFF; // Open Bus
+	for (int i = 0; i < PCE.BankSlots; i++) {
+		int bank = bank_slots[i].bank;
+		if (bank_slots[i].state != SLOT_FREE && bank >= first && bank <= last)
+			bank_slot_release(i, restore);
+	}
+	// The ROM may have been reloaded, forget the PSRAM copies too
+	if (first == 0x00 && last == 0xFF) {
+		memset(PCE.BankHeat, 0, sizeof(PCE.BankHeat));
+		for (int i = 0; i < PCE.BankSlots; i++)
+			bank_slots[i].store = ~0;
+	}
+}
 
-	// The last read value in 0800-017FF is read from the io buffer
-	if (A >= 0x800 && A < 0x1800)
-		ret = PCE.io_buffer;
 
-	switch (A & 0x1F00) {
-	case 0x0000:                /* VDC */
-		switch (A & 3) {
-		case 0:
-			ret = PCE.VDC.status;
-			PCE.VDC.status = 0;
-			break;
-		case 1:
-			ret = 0;
-			break;
-		case 2:
-			if (PCE.VDC.reg == VRR) {             // // VRAM Read Register (LSB)
-				ret = PCE.VRAM[IO_VDC_REG[MARR].W & 0x7FFF] & 0xFF;
-			} else {
-				ret = IO_VDC_REG_ACTIVE.B.l;
-			}
-			break;
-		case 3:
-			if (PCE.VDC.reg == VRR) {            // VRAM Read Register (MSB)
-				ret = PCE.VRAM[IO_VDC_REG[MARR].W & 0x7FFF] >> 8;
-				IO_VDC_REG_INC(MARR);
-			} else {
-				ret = IO_VDC_REG_ACTIVE.B.h;
-			}
-			break;
-		}
-		break;
+static void
+bank_cache_update(void)
+{
+	int best = -1, slot = -1;
+	uint32_t best_heat = BANK_HEAT_MIN;
 
-	case 0x0400:                /* VCE */
-		switch (A & 7) {
-		case 0: ret = 0xFF; break; // Write only
-		case 1: ret = 0xFF; break; // Unused
-		case 2: ret = 0xFF; break; // Write only
-		case 3: ret = 0xFF; break; // Write only
-		case 4: ret = PCE.VCE.regs[PCE.VCE.reg].B.l; break; // Color LSB (8 bit)
-		case 5: {
-			ret = (PCE.VCE.regs[PCE.VCE.reg++].B.h) | 0xFE; // Color MSB (1 bit)
-			PCE.VCE.reg &= 0x1FF;
-			break;
-		}
-		case 6: ret = 0xFF; break; // Unused
+	bank_frame++;
+
+	// Slots of the banks mapped now or used recently stay
+	for (int i = 0; i < PCE.BankSlots; i++) {
+		if (bank_slots[i].state == SLOT_FREE) {
+			slot = i;
+			continue;
 		}
-		break;
+		if (PCE.BankHeat[bank_slots[i].bank] || memchr(PCE.MMR, bank_slots[i].bank, 8))
+			bank_slots[i].used = bank_frame;
+	}
 
-	case 0x0800:                /* PSG */
-		switch (A & 15) {
-		case 0: ret = PCE.PSG.ch; break;
-		case 1: ret = PCE.PSG.volume; break;
-		case 2: ret = PCE.PSG.chan[PCE.PSG.ch].freq_lsb; break;
-		case 3: ret = PCE.PSG.chan[PCE.PSG.ch].freq_msb; break;
-		case 4: ret = PCE.PSG.chan[PCE.PSG.ch].control; break;
-		case 5: ret = PCE.PSG.chan[PCE.PSG.ch].balance; break;
-		case 6: ret = PCE.PSG.chan[PCE.PSG.ch].wave_index; break;
-		case 7: ret = PCE.PSG.chan[PCE.PSG.ch].noise_ctrl; break;
-		case 8: ret = PCE.PSG.lfo_freq; break;
-		case 9: ret = PCE.PSG.lfo_ctrl; break;
+	for (int i = 0; i < 256; i++) {
+		if (PCE.BankHeat[i] >= best_heat && pce_bank_is_rom(i)
+			&& !pce_bank_in_sram(PCE.MemoryMapR[i])) {
+			best_heat = PCE.BankHeat[i];
+			best = i;
 		}
-		break;
+		PCE.BankHeat[i] >>= 1;
+	}
 
-	case 0x0C00:                /* Timer */
-		ret = (PCE.io_buffer & 0x80);
-		if (PCE.Timer.cycles_counter == PCE.Cycles)
-			ret |= (PCE.Timer.counter - 1) & 0x7F;
-		else
-			ret |= PCE.Timer.counter;
-		break;
+	if (best < 0)
+		return;
 
-	case 0x1000:                /* Joypad */
-		ret = PCE.Joypad.regs[PCE.Joypad.counter] ^ 0xff;
-		if (PCE.Joypad.nibble & 1)
-			ret >>= 4;
-		else {
-			ret &= 15;
-			PCE.Joypad.counter = ((PCE.Joypad.counter + 1) % 5);
+	// Evict the least recently used bank, unless it's still in use
+	if (slot < 0) {
+		for (int i = 0; i < PCE.BankSlots; i++) {
+			if (bank_slots[i].used < bank_frame && (slot < 0 || bank_slots[i].used < bank_slots[slot].used))
+				slot = i;
 		}
-		ret |= 0x30; // those 2 bits are always on, bit 6 = 0 (Jap), bit 7 = 0 (Attached cd)
-		break;
+		if (slot < 0)
+			return;
+		bank_slot_release(slot, true);
+	}
 
-	case 0x1400:                /* IRQ */
-		switch (A & 3) {
-		case 2:
-			ret = CPU.irq_mask | (PCE.io_buffer & ~INT_MASK);
-			break;
-		case 3:
-			ret = CPU.irq_lines;
-			CPU.irq_lines = 0;
+	memcpy(BankCache[slot], PCE.MemoryMapR[best], 0x2000);
+	bank_slots[slot].rom = PCE.MemoryMapR[best];
+	bank_slots[slot].store = ~0;
+	bank_slots[slot].bank = best;
+	bank_slots[slot].state = SLOT_FLASH;
+	bank_slots[slot].used = bank_frame;
+	PCE.MemoryMapR[best] = BankCache[slot];
+	PCE.BankLoads++;
+	bank_remap(best);
+}
+
+
+#if USE_PSRAM_ROM
+/**
+  * Load a PSRAM bank being mapped to the free slot still holding it or to
+  * the least recently used slot whose bank isn't mapped. Called by
+  * pce_bank_set.
+  **/
+void
+pce_bank_fetch(uint8_t bank)
+{
+	uint32_t store = PCE.BankStore[bank];
+	int slot = -1;
+
+	for (int i = 0; i < PCE.BankSlots; i++) {
+		bool in_use = bank_slots[i].state != SLOT_FREE;
+		if (!in_use && bank_slots[i].store == store) {
+			slot = i;
 			break;
 		}
-		break;
+		if ((!in_use || !memchr(PCE.MMR, bank_slots[i].bank, 8))
+			&& (slot < 0 || bank_slots[i].used < bank_slots[slot].used))
+			slot = i;
+	}
 
-	case 0x1A00:                // Arcade Card
-		MESSAGE_INFO("Arcade Card not supported : 0x%04X\n", A);
-		break;
+	// Can't happen with a slot per page, the bank would stay behind MAP_PSRAM
+	if (slot < 0)
+		return;
 
-	case 0x1800:                // CD-ROM extention
-	case 0x18C0:                // Super System Card
-		MESSAGE_INFO("CD Emulation not implemented : 0x%04X\n", A);
-		break;
+	bank_slot_release(slot, false);
+
+	if (bank_slots[slot].store != store) {
+		osd_psram_read(store, BankCache[slot], 0x2000);
+		bank_slots[slot].store = store;
+		PCE.BankLoads++;
+	}
+	bank_slots[slot].bank = bank;
+	bank_slots[slot].state = SLOT_PSRAM;
+	bank_slots[slot].used = bank_frame;
+	PCE.MemoryMapR[bank] = BankCache[slot];
+	if (!PCE.MemoryMapW[bank] && PCE.MemoryHandlerW[bank] == MAP_PSRAM) {
+		PCE.MemoryMapW[bank] = BankCache[slot];
+		bank_slots[slot].state = SLOT_PSRAM_RW;
 	}
+}
+#endif
 
-	TRACE_IO("IO Read %02x at %04x\n", ret, A);
+#else
 
-	// The last read value in 0800-017FF is saved in the io buffer
-	if (A >= 0x800 && A < 0x1800)
-		PCE.io_buffer = ret;
+static void bank_cache_update(void) {}
+void pce_bank_cache_drop(int first, int last, bool restore) {}
 
-	return ret;
+#if USE_PSRAM_ROM
+#error "USE_PSRAM_ROM needs the SRAM bank cache"
+#endif
+
+#endif
+
+
+/**
+  * Card arena: SRAM set aside for the loaded card. LoadCard resets it, the
+  * mapper allocates the card RAM it needs from the top and pce_arena_commit
+  * gives the bottom that's left to the bank cache, so the cards without RAM
+  * get more slots.
+  **/
+#define ARENA_REGIONS 4
+
+static struct {
+	const char *name;
+	uint32_t size;
+} arena_regions[ARENA_REGIONS];
+
+static int arena_count;
+static uint32_t arena_used;
+
+
+void
+pce_arena_reset(void)
+{
+	// The slots of the previous card are dropped without writing them back
+#if SRAM_BANK_SLOTS
+	memset(bank_slots, 0, sizeof(bank_slots));
+	for (int i = 0; i < BANK_SLOTS_MAX; i++)
+		bank_slots[i].store = ~0;
+#endif
+	PCE.BankSlots = 0;
+	arena_count = 0;
+	arena_used = 0;
 }
 
 
-inline void
-pce_writeIO(uint16_t A, uint8_t V)
+void *
+pce_arena_alloc(const char *name, size_t size)
 {
-	TRACE_IO("IO Write %02x at %04x\n", V, A);
+	size = (size + 7) & ~7;
 
-	// The last write value in 0800-017FF is saved in the io buffer
-	if (A >= 0x800 && A < 0x1800)
-		PCE.io_buffer = V;
+	if (arena_count == ARENA_REGIONS || arena_used + size > CARD_ARENA_SIZE) {
+		MESSAGE_ERROR("No room for %s (%d bytes) in the card arena\n", name, (int)size);
+		return NULL;
+	}
 
-	switch (A & 0x1F00) {
-	case 0x0000:                /* VDC */
-		switch (A & 3) {
-		case 0: // Latch
-			PCE.VDC.reg = V & 31;
-			return;
+	arena_regions[arena_count].name = name;
+	arena_regions[arena_count].size = size;
+	arena_count++;
+	arena_used += size;
 
-		case 1: // Not used
-			return;
+	void *ptr = CardArena + CARD_ARENA_SIZE - arena_used;
+	memset(ptr, 0, size);
+	return ptr;
+}
 
-		case 2: // VDC data (LSB)
-			switch (PCE.VDC.reg & 31) {
-			case MAWR:                          // Memory Address Write Register
-				break;
 
-			case MARR:                          // Memory Address Read Register
-				break;
+void
+pce_arena_commit(void)
+{
+#if SRAM_BANK_SLOTS
+	PCE.BankSlots = (CARD_ARENA_SIZE - arena_used) / 0x2000;
+#endif
 
-			case VWR:                           // VRAM Write Register
-				break;
+	char report[160];
+	pce_memory_report(report, sizeof(report));
+	MESSAGE_INFO("%s\n", report);
+}
 
-			case vdc3:                          // Unused
-				break;
 
-			case vdc4:                          // Unused
-				break;
+/**
+  * Memory budget of the loaded card: the static state and how the card
+  * arena is split
+  **/
+size_t
+pce_memory_report(char *buf, size_t len)
+{
+	size_t pos = snprintf(buf, len, "PCE %u KB, card arena %u KB:",
+		(unsigned)(sizeof(PCE) >> 10), (unsigned)(CARD_ARENA_SIZE >> 10));
 
-			case CR:                            // Control Register
-				if (IO_VDC_REG_ACTIVE.B.l != V)
-					gfx_latch_context(0);
-				break;
+	for (int i = 0; i < arena_count && pos < len; i++) {
+		pos += snprintf(buf + pos, len - pos, " %s %u KB,",
+			arena_regions[i].name, (unsigned)((arena_regions[i].size + 1023) >> 10));
+	}
+	if (pos < len) {
+		pos += snprintf(buf + pos, len - pos, " %u bank slots, %u KB unused",
+			(unsigned)PCE.BankSlots,
+			(unsigned)((CARD_ARENA_SIZE - arena_used - PCE.BankSlots * 0x2000) >> 10));
+	}
+	return pos;
+}
 
-			case RCR:                           // Raster Compare Register
-				break;
 
-			case BXR:
-				if (IO_VDC_REG_ACTIVE.B.l != V)
-					gfx_latch_context(0);
-				break;
+/**
+ * Functions to access PCE hardware
+ **/
 
-			case BYR:                           // Vertical screen offset
-				/*
-					if (IO_VDC_REG[BYR].B.l == V)
-					return;
-					*/
-				gfx_latch_context(0);
-				PCE.ScrollYDiff = PCE.Scanline - 1 - IO_VDC_MINLINE;
-				break;
+static inline void
+timer_run(void)
+{
+	while (PCE.Timer.running && PCE.Timer.cycles_counter <= PCE.Cycles) {
+		PCE.Timer.cycles_counter += CYCLES_PER_TIMER_TICK;
+		// Trigger when it underflows from 0
+		if (PCE.Timer.counter > 0x7F) {
+			PCE.Timer.counter = PCE.Timer.reload;
+			CPU.irq_lines |= INT_TIMER;
+		}
+		PCE.Timer.counter--;
+	}
+}
 
-			case MWR:                           // Memory Width Register
-				break;
 
-			case HSR:
-				V = 0x1F;
-				PCE.VDC.mode_chg = 1;
-				break;
+/**
+  * Write a block to the VDC data port, alternating between $0002 and $0003
+  * (starting with the MSB if msb is set), as TIA does for VRAM uploads.
+  * Same result as calling pce_writeIO for each byte.
+  **/
+void
+pce_vdc_write_block(const uint8_t *src, size_t len, int msb)
+{
+	if (PCE.VDC.reg != VWR) {
+		for (; len > 0; len--, msb ^= 1)
+			pce_writeIO(2 + msb, *src++);
+		return;
+	}
+
+	PROFILE_IO(io_writes, 0x0002, len);
 
-			case HDR:                           // Horizontal Definition
-				V &= 0x7F;
-				PCE.VDC.mode_chg = 1;
-				break;
+	const unsigned inc_table[] = {1, 32, 64, 128};
+	unsigned inc = inc_table[(IO_VDC_REG[CR].W >> 11) & 3];
+	uint16_t addr = IO_VDC_REG[MAWR].W;
+	uint8_t lo = IO_VDC_REG[VWR].B.l;
+	uint8_t hi = IO_VDC_REG[VWR].B.h;
 
-			case VPR:
-				V &= 0x1F;
-				PCE.VDC.mode_chg = 1;
-				break;
-			case VDW:
-			case VCR:
-				PCE.VDC.mode_chg = 1;
-				break;
+	if (msb && len > 0) {
+		hi = *src++;
+		if (addr < 0x8000)
+			pce_vram_write(addr, (hi << 8) | lo);
+		addr += inc;
+		len--;
+	}
 
-			case DCR:                           // DMA Control
-				break;
+	for (; len >= 2; len -= 2, src += 2) {
+		lo = src[0];
+		hi = src[1];
+		if (addr < 0x8000)
+			pce_vram_write(addr, (hi << 8) | lo);
+		addr += inc;
+	}
 
-			case SOUR:                          // DMA source address
-				break;
+	if (len > 0) {
+		lo = *src;
+	}
 
-			case DISTR:                         // DMA destination address
-				break;
+	IO_VDC_REG[MAWR].W = addr;
+	IO_VDC_REG[VWR].B.l = lo;
+	IO_VDC_REG[VWR].B.h = hi;
+}
 
-			case LENR:                          // DMA transfer from VRAM to VRAM
-				break;
 
-			case SATB:                          // DMA from VRAM to SATB
-				break;
-			}
-			IO_VDC_REG_ACTIVE.B.l = V;
-			TRACE_GFX("VDC[%02x].l=0x%02x\n", PCE.VDC.reg, V);
-			return;
+/**
+  * IO page ($FF) handlers, one per group of registers. Each group decodes
+  * the low bits of the address, the hardware only looks at A & 0x1FFF.
+  **/
 
-		case 3: // VDC data (MSB)
-			switch (PCE.VDC.reg & 31) {
-			case MAWR:                          // Memory Address Write Register
-				break;
+static uint8_t
+open_bus_read(uint16_t A)
+{
+	return 0xFF;
+}
 
-			case MARR:                          // Memory Address Read Register
-				break;
 
-			case VWR:                           // VRAM Write Register
-				// I am not 100% sure if MAWR should wrap instead, eg IO_VDC_REG[MAWR].W & 0x7FFF
-				if (IO_VDC_REG[MAWR].W < 0x8000) {
-					PCE.VRAM[IO_VDC_REG[MAWR].W] = (V << 8) | IO_VDC_REG_ACTIVE.B.l;
-				}
-				IO_VDC_REG_INC(MAWR);
-				break;
+static void
+open_bus_write(uint16_t A, uint8_t V)
+{
+	MESSAGE_DEBUG("ignored I/O write: %04x,%02x at PC = %04X\n", A, V, CPU.PC);
+}
 
-			case vdc3:                          // Unused
-				break;
 
-			case vdc4:                          // Unused
-				break;
+// The last value read or written in $0800-$17FF is latched in the io buffer
+// and read back from unused registers
+static uint8_t
+io_buffer_read(uint16_t A)
+{
+	return PCE.io_buffer;
+}
 
-			case CR:                            // Control Register
-				if (IO_VDC_REG_ACTIVE.B.h != V)
-					gfx_latch_context(0);
-				break;
 
-			case RCR:                           // Raster Compare Register
-				V &= 0x3;
-				break;
+static uint8_t
+vdc_read(uint16_t A)
+{
+	uint8_t ret = 0xFF;
 
-			case BXR:                           // Horizontal screen offset
-				V &= 0x3;
-				if (IO_VDC_REG_ACTIVE.B.h != V) {
-					gfx_latch_context(0);
-				}
-				break;
+	switch (A & 3) {
+	case 0:
+		ret = PCE.VDC.status;
+		PCE.VDC.status = 0;
+		break;
+	case 1:
+		ret = 0;
+		break;
+	case 2:
+		if (PCE.VDC.reg == VRR) {             // // VRAM Read Register (LSB)
+			ret = PCE.VRAM[IO_VDC_REG[MARR].W & 0x7FFF] & 0xFF;
+		} else {
+			ret = IO_VDC_REG_ACTIVE.B.l;
+		}
+		break;
+	case 3:
+		if (PCE.VDC.reg == VRR) {            // VRAM Read Register (MSB)
+			ret = PCE.VRAM[IO_VDC_REG[MARR].W & 0x7FFF] >> 8;
+			IO_VDC_REG_INC(MARR);
+		} else {
+			ret = IO_VDC_REG_ACTIVE.B.h;
+		}
+		break;
+	}
 
-			case BYR:                           // Vertical screen offset
+	return ret;
+}
+
+
+static void
+vdc_write(uint16_t A, uint8_t V)
+{
+	switch (A & 3) {
+	case 0: // Latch
+		PCE.VDC.reg = V & 31;
+		return;
+
+	case 1: // Not used
+		return;
+
+	case 2: // VDC data (LSB)
+		switch (PCE.VDC.reg & 31) {
+		case MAWR:                          // Memory Address Write Register
+			break;
+
+		case MARR:                          // Memory Address Read Register
+			break;
+
+		case VWR:                           // VRAM Write Register
+			break;
+
+		case vdc3:                          // Unused
+			break;
+
+		case vdc4:                          // Unused
+			break;
+
+		case CR:                            // Control Register
+			if (IO_VDC_REG_ACTIVE.B.l != V)
 				gfx_latch_context(0);
-				V &= 0x1;
-				PCE.ScrollYDiff = PCE.Scanline - 1 - IO_VDC_MINLINE;
-				if (PCE.ScrollYDiff < 0) {
-					MESSAGE_DEBUG("PCE.ScrollYDiff went negative when substraction VPR.h/.l (%d,%d)\n",
-						IO_VDC_REG[VPR].B.h, IO_VDC_REG[VPR].B.l);
-				}
-				break;
-
-			case MWR:                           // Memory Width Register
-				break;
-
-			case HSR:
-				V &= 0x7F;
-				PCE.VDC.mode_chg = 1;
-				break;
-
-			case HDR:                           // Horizontal Definition
-				V &= 0x7F;
-				TRACE_GFX("VDC[HDR].h = %d\n", V);
-				break;
-
-			case VPR:
-				V &= 0x7F;
-				PCE.VDC.mode_chg = 1;
-				break;
-			case VDW:
-				V &= 0x1;
-				PCE.VDC.mode_chg = 1;
-				break;
-			case VCR:
-				PCE.VDC.mode_chg = 1;
-				return;//not interested in the MSB of VCR
-
-			case DCR:                           // DMA Control
-				break;
-
-			case SOUR:                          // DMA source address
-				break;
-
-			case DISTR:                         // DMA destination address
-				break;
-
-			case LENR:                          // DMA transfer from VRAM to VRAM
-				IO_VDC_REG[LENR].B.h = V;
-
-				int src_inc = (IO_VDC_REG[DCR].W & 8) ? -1 : 1;
-				int dst_inc = (IO_VDC_REG[DCR].W & 4) ? -1 : 1;
-
-				while (IO_VDC_REG[LENR].W != 0xFFFF) {
-					if (IO_VDC_REG[DISTR].W < 0x8000) {
-						PCE.VRAM[IO_VDC_REG[DISTR].W] = PCE.VRAM[IO_VDC_REG[SOUR].W];
-					}
-					IO_VDC_REG[SOUR].W += src_inc;
-					IO_VDC_REG[DISTR].W += dst_inc;
-					IO_VDC_REG[LENR].W -= 1;
-				}
+			break;
 
-				gfx_irq(VDC_STAT_DV);
+		case RCR:                           // Raster Compare Register
+			break;
+
+		case BXR:
+			if (IO_VDC_REG_ACTIVE.B.l != V)
+				gfx_latch_context(0);
+			break;
+
+		case BYR:                           // Vertical screen offset
+			/*
+				if (IO_VDC_REG[BYR].B.l == V)
 				return;
+				*/
+			gfx_latch_context(0);
+			PCE.ScrollYDiff = PCE.Scanline - 1 - IO_VDC_MINLINE;
+			break;
 
-			case SATB:                          // DMA from VRAM to SATB
-				PCE.VDC.satb = DMA_TRANSFER_PENDING;
-				break;
-			}
-			IO_VDC_REG_ACTIVE.B.h = V;
-			TRACE_GFX("VDC[%02x].h=0x%02x\n", PCE.VDC.reg, V);
-			return;
+		case MWR:                           // Memory Width Register
+			break;
+
+		case HSR:
+			V = 0x1F;
+			PCE.VDC.mode_chg = 1;
+			break;
+
+		case HDR:                           // Horizontal Definition
+			V &= 0x7F;
+			PCE.VDC.mode_chg = 1;
+			break;
+
+		case VPR:
+			V &= 0x1F;
+			PCE.VDC.mode_chg = 1;
+			break;
+		case VDW:
+		case VCR:
+			PCE.VDC.mode_chg = 1;
+			break;
+
+		case DCR:                           // DMA Control
+			break;
+
+		case SOUR:                          // DMA source address
+			break;
+
+		case DISTR:                         // DMA destination address
+			break;
+
+		case LENR:                          // DMA transfer from VRAM to VRAM
+			break;
+
+		case SATB:                          // DMA from VRAM to SATB
+			break;
 		}
-		break;
+		IO_VDC_REG_ACTIVE.B.l = V;
+		TRACE_GFX("VDC[%02x].l=0x%02x\n", PCE.VDC.reg, V);
+		return;
 
-	case 0x0400:                /* VCE */
-		switch (A & 7) {
-		case 0:                                 // VCE control
-			return;
+	case 3: // VDC data (MSB)
+		switch (PCE.VDC.reg & 31) {
+		case MAWR:                          // Memory Address Write Register
+			break;
 
-		case 1:                                 // Not used
-			return;
+		case MARR:                          // Memory Address Read Register
+			break;
 
-		case 2:                                 // Color table address (LSB)
-			PCE.VCE.reg &= 0x100;
-			PCE.VCE.reg |= V;
-			return;
+		case VWR:                           // VRAM Write Register
+			// I am not 100% sure if MAWR should wrap instead, eg IO_VDC_REG[MAWR].W & 0x7FFF
+			if (IO_VDC_REG[MAWR].W < 0x8000) {
+				pce_vram_write(IO_VDC_REG[MAWR].W, (V << 8) | IO_VDC_REG_ACTIVE.B.l);
+			}
+			IO_VDC_REG_INC(MAWR);
+			break;
 
-		case 3:                                 // Color table address (MSB)
-			PCE.VCE.reg &= 0xFF;
-            PCE.VCE.reg |= (V & 1) << 8;
-			return;
+		case vdc3:                          // Unused
+			break;
+
+		case vdc4:                          // Unused
+			break;
 
-		case 4:                                 // Color table data (LSB)
-			PCE.VCE.regs[PCE.VCE.reg].B.l = V;
-			{
-				size_t n = PCE.VCE.reg;
-				size_t c = PCE.VCE.regs[n].W >> 1;
-				if (n == 0) {
-					for (int i = 0; i < 256; i += 16)
-						PCE.Palette[i] = c;
-				} else if (n & 15)
-					PCE.Palette[n] = c;
+		case CR:                            // Control Register
+			if (IO_VDC_REG_ACTIVE.B.h != V)
+				gfx_latch_context(0);
+			break;
+
+		case RCR:                           // Raster Compare Register
+			V &= 0x3;
+			break;
+
+		case BXR:                           // Horizontal screen offset
+			V &= 0x3;
+			if (IO_VDC_REG_ACTIVE.B.h != V) {
+				gfx_latch_context(0);
 			}
-			return;
+			break;
 
-		case 5:                                 // Color table data (MSB)
-			PCE.VCE.regs[PCE.VCE.reg].B.h = V;
-			{
-				size_t n = PCE.VCE.reg;
-				size_t c = PCE.VCE.regs[n].W >> 1;
-				if (n == 0) {
-					for (int i = 0; i < 256; i += 16)
-						PCE.Palette[i] = c;
-				} else if (n & 15)
-					PCE.Palette[n] = c;
+		case BYR:                           // Vertical screen offset
+			gfx_latch_context(0);
+			V &= 0x1;
+			PCE.ScrollYDiff = PCE.Scanline - 1 - IO_VDC_MINLINE;
+			if (PCE.ScrollYDiff < 0) {
+				MESSAGE_DEBUG("PCE.ScrollYDiff went negative when substraction VPR.h/.l (%d,%d)\n",
+					IO_VDC_REG[VPR].B.h, IO_VDC_REG[VPR].B.l);
 			}
-			PCE.VCE.reg = (PCE.VCE.reg + 1) & 0x1FF;
-			return;
+			break;
 
-		case 6:                                 // Not used
-			return;
+		case MWR:                           // Memory Width Register
+			break;
 
-		case 7:                                 // Not used
-			return;
-		}
-		break;
+		case HSR:
+			V &= 0x7F;
+			PCE.VDC.mode_chg = 1;
+			break;
 
-	case 0x0800:                /* PSG */
-		switch (A & 15) {
-		case 0:                                 // Select PSG channel
-			PCE.PSG.ch = MIN(V & 7, 5);
-			return;
+		case HDR:                           // Horizontal Definition
+			V &= 0x7F;
+			TRACE_GFX("VDC[HDR].h = %d\n", V);
+			break;
 
-		case 1:                                 // Select global volume
-			PCE.PSG.volume = V;
-			return;
+		case VPR:
+			V &= 0x7F;
+			PCE.VDC.mode_chg = 1;
+			break;
+		case VDW:
+			V &= 0x1;
+			PCE.VDC.mode_chg = 1;
+			break;
+		case VCR:
+			PCE.VDC.mode_chg = 1;
+			return;//not interested in the MSB of VCR
 
-		case 2:                                 // Frequency setting, 8 lower bits
-			PCE.PSG.chan[PCE.PSG.ch].freq_lsb = V;
-			return;
+		case DCR:                           // DMA Control
+			break;
 
-		case 3:                                 // Frequency setting, 4 upper bits
-			PCE.PSG.chan[PCE.PSG.ch].freq_msb = V & 0xF;
-			return;
+		case SOUR:                          // DMA source address
+			break;
 
-		case 4:
-			if ((V & 0xC0) == (PSG_DDA_ENABLE)) {
-				PCE.PSG.chan[PCE.PSG.ch].wave_index = 0; // Reset wave index pointer
-			}
+		case DISTR:                         // DMA destination address
+			break;
 
-			PCE.PSG.chan[PCE.PSG.ch].control = V;
-			return;
+		case LENR:                          // DMA transfer from VRAM to VRAM
+			IO_VDC_REG[LENR].B.h = V;
 
-		case 5:                                 // Set channel specific volume
-			PCE.PSG.chan[PCE.PSG.ch].balance = V;
-			return;
+			int src_inc = (IO_VDC_REG[DCR].W & 8) ? -1 : 1;
+			int dst_inc = (IO_VDC_REG[DCR].W & 4) ? -1 : 1;
 
-		case 6:                                 // Put a value into the waveform or direct audio buffers
-			switch (PCE.PSG.chan[PCE.PSG.ch].control & 0xC0)
-			{
-			case 0: // Write to the wave buffer and increment the counter
-				PCE.PSG.chan[PCE.PSG.ch].wave_data[PCE.PSG.chan[PCE.PSG.ch].wave_index] = V & 0x1F;
-				PCE.PSG.chan[PCE.PSG.ch].wave_index++; // Inc pointer
-				PCE.PSG.chan[PCE.PSG.ch].wave_index &= 0x1F; // Wrap at 32
-				break;
-			case PSG_CHAN_ENABLE|PSG_DDA_ENABLE: // Update DDA sample
-				PCE.PSG.chan[PCE.PSG.ch].dda_data[PCE.PSG.chan[PCE.PSG.ch].dda_index] = V & 0x1F;
-				PCE.PSG.chan[PCE.PSG.ch].dda_count = MIN(PCE.PSG.chan[PCE.PSG.ch].dda_count+1, 0x100);
-				PCE.PSG.chan[PCE.PSG.ch].dda_index = (PCE.PSG.chan[PCE.PSG.ch].dda_index+1) & 0xFF;
-				break;
+			while (IO_VDC_REG[LENR].W != 0xFFFF) {
+				if (IO_VDC_REG[DISTR].W < 0x8000) {
+					pce_vram_write(IO_VDC_REG[DISTR].W, PCE.VRAM[IO_VDC_REG[SOUR].W & 0x7FFF]);
+				}
+				IO_VDC_REG[SOUR].W += src_inc;
+				IO_VDC_REG[DISTR].W += dst_inc;
+				IO_VDC_REG[LENR].W -= 1;
 			}
-			return;
 
-		case 7:
-			PCE.PSG.chan[PCE.PSG.ch].noise_ctrl = V;
+			gfx_irq(VDC_STAT_DV);
+			pce_schedule();
 			return;
 
-		case 8:
-			PCE.PSG.lfo_freq = V;
-			return;
+		case SATB:                          // DMA from VRAM to SATB
+			PCE.VDC.satb = DMA_TRANSFER_PENDING;
+			break;
+		}
+		IO_VDC_REG_ACTIVE.B.h = V;
+		TRACE_GFX("VDC[%02x].h=0x%02x\n", PCE.VDC.reg, V);
+		return;
+	}
+}
 
-		case 9:
-			PCE.PSG.lfo_ctrl = V;
-			return;
+
+static uint8_t
+vce_read(uint16_t A)
+{
+	switch (A & 7) {
+	case 4: return PCE.VCE.regs[PCE.VCE.reg].B.l; // Color LSB (8 bit)
+	case 5: {
+		uint8_t ret = (PCE.VCE.regs[PCE.VCE.reg++].B.h) | 0xFE; // Color MSB (1 bit)
+		PCE.VCE.reg &= 0x1FF;
+		return ret;
+	}
+	}
+	return 0xFF; // Write only or unused
+}
+
+
+static void
+vce_write(uint16_t A, uint8_t V)
+{
+	switch (A & 7) {
+	case 0:                                 // VCE control
+		return;
+
+	case 1:                                 // Not used
+		return;
+
+	case 2:                                 // Color table address (LSB)
+		PCE.VCE.reg &= 0x100;
+		PCE.VCE.reg |= V;
+		return;
+
+	case 3:                                 // Color table address (MSB)
+		PCE.VCE.reg &= 0xFF;
+		PCE.VCE.reg |= (V & 1) << 8;
+		return;
+
+	case 4:                                 // Color table data (LSB)
+		pce_render_fence();
+		PCE.VCE.regs[PCE.VCE.reg].B.l = V;
+		{
+			size_t n = PCE.VCE.reg;
+			size_t c = PCE.VCE.regs[n].W >> 1;
+			if (n == 0) {
+				for (int i = 0; i < 256; i += 16)
+					PCE.Palette[i] = c;
+			} else if (n & 15)
+				PCE.Palette[n] = c;
 		}
-		break;
+		return;
 
-	case 0x0C00:                /* Timer */
-		switch (A & 1) {
-		case 0:
-			PCE.Timer.reload = (V & 0x7F); // + 1;
-			return;
-		case 1:
-			V &= 1;
-            if (V && !PCE.Timer.running){
-                // PCE.Timer.cycles_counter = PCE.Cycles + CYCLES_PER_TIMER_TICK;
-				PCE.Timer.counter = PCE.Timer.reload;
-            }
-			PCE.Timer.running = V;
-			return;
+	case 5:                                 // Color table data (MSB)
+		pce_render_fence();
+		PCE.VCE.regs[PCE.VCE.reg].B.h = V;
+		{
+			size_t n = PCE.VCE.reg;
+			size_t c = PCE.VCE.regs[n].W >> 1;
+			if (n == 0) {
+				for (int i = 0; i < 256; i += 16)
+					PCE.Palette[i] = c;
+			} else if (n & 15)
+				PCE.Palette[n] = c;
 		}
-		break;
+		PCE.VCE.reg = (PCE.VCE.reg + 1) & 0x1FF;
+		return;
 
-	case 0x1000:                /* Joypad */
-		PCE.Joypad.nibble = V & 1;
-		if (V & 2)
-			PCE.Joypad.counter = 0;
+	case 6:                                 // Not used
 		return;
 
-	case 0x1400:                /* IRQ */
-		switch (A & 3) {
-		case 2:
-			CPU.irq_mask = V & INT_MASK;
-			return;
-		case 3:
-			CPU.irq_lines &= ~INT_TIMER;
-			return;
+	case 7:                                 // Not used
+		return;
+	}
+}
+
+
+static uint8_t
+psg_read(uint16_t A)
+{
+	switch (A & 15) {
+	case 0: return PCE.PSG.ch;
+	case 1: return PCE.PSG.volume;
+	case 2: return PCE.PSG.chan[PCE.PSG.ch].freq_lsb;
+	case 3: return PCE.PSG.chan[PCE.PSG.ch].freq_msb;
+	case 4: return PCE.PSG.chan[PCE.PSG.ch].control;
+	case 5: return PCE.PSG.chan[PCE.PSG.ch].balance;
+	case 6: return PCE.PSG.chan[PCE.PSG.ch].wave_index;
+	case 7: return PCE.PSG.chan[PCE.PSG.ch].noise_ctrl;
+	case 8: return PCE.PSG.lfo_freq;
+	case 9: return PCE.PSG.lfo_ctrl;
+	}
+	return PCE.io_buffer;
+}
+
+
+static void
+psg_write(uint16_t A, uint8_t V)
+{
+	psg_chan_t *chan = &PCE.PSG.chan[PCE.PSG.ch];
+
+	switch (A & 15) {
+	case 0:                                 // Select PSG channel
+		PCE.PSG.ch = MIN(V & 7, 5);
+		return;
+
+	case 1:                                 // Select global volume
+		PCE.PSG.volume = V;
+		return;
+
+	case 2:                                 // Frequency setting, 8 lower bits
+		chan->freq_lsb = V;
+		return;
+
+	case 3:                                 // Frequency setting, 4 upper bits
+		chan->freq_msb = V & 0xF;
+		return;
+
+	case 4:
+		if ((V & 0xC0) == (PSG_DDA_ENABLE)) {
+			chan->wave_index = 0; // Reset wave index pointer
 		}
-		break;
 
-	case 0x1A00:                /* Arcade Card */
-		MESSAGE_INFO("Arcade Card not supported : %d into 0x%04X\n", V, A);
+		chan->control = V;
 		return;
 
-	case 0x1800:                /* CD-ROM extention */
-		MESSAGE_INFO("CD Emulation not implemented : %d 0x%04X\n", V, A);
+	case 5:                                 // Set channel specific volume
+		chan->balance = V;
 		return;
 
-	case 0x1F00:                /* Street Fighter 2 Mapper */
-		cart_write(A, V);
+	case 6:                                 // Put a value into the waveform or direct audio buffers
+		switch (chan->control & 0xC0)
+		{
+		case 0: // Write to the wave buffer and increment the counter
+			chan->wave_data[chan->wave_index] = V & 0x1F;
+			chan->wave_index++; // Inc pointer
+			chan->wave_index &= 0x1F; // Wrap at 32
+			break;
+		case PSG_CHAN_ENABLE|PSG_DDA_ENABLE: // Update DDA sample
+			chan->dda_data[chan->dda_index] = V & 0x1F;
+			chan->dda_count = MIN(chan->dda_count+1, 0x100);
+			chan->dda_index = (chan->dda_index+1) & 0xFF;
+			break;
+		}
+		return;
+
+	case 7:
+		chan->noise_ctrl = V;
+		return;
+
+	case 8:
+		PCE.PSG.lfo_freq = V;
+		return;
+
+	case 9:
+		PCE.PSG.lfo_ctrl = V;
 		return;
 	}
 
-	MESSAGE_DEBUG("ignored I/O write: %04x,%02x at PC = %04X\n", A, V, CPU.PC);
+	open_bus_write(A, V);
+}
+
+
+static uint8_t
+timer_read(uint16_t A)
+{
+	return (PCE.io_buffer & 0x80) | PCE.Timer.counter;
+}
+
+
+static void
+timer_write(uint16_t A, uint8_t V)
+{
+	switch (A & 1) {
+	case 0:
+		PCE.Timer.reload = (V & 0x7F); // + 1;
+		return;
+	case 1:
+		V &= 1;
+		if (V && !PCE.Timer.running) {
+			PCE.Timer.cycles_counter = PCE.Cycles + CYCLES_PER_TIMER_TICK;
+			PCE.Timer.counter = PCE.Timer.reload;
+		}
+		PCE.Timer.running = V;
+		pce_schedule();
+		return;
+	}
+}
+
+
+static uint8_t
+joypad_read(uint16_t A)
+{
+	uint8_t ret = PCE.Joypad.regs[PCE.Joypad.counter] ^ 0xff;
+	if (PCE.Joypad.nibble & 1)
+		ret >>= 4;
+	else {
+		ret &= 15;
+		PCE.Joypad.counter = ((PCE.Joypad.counter + 1) % 5);
+	}
+	return ret | 0x30; // those 2 bits are always on, bit 6 = 0 (Jap), bit 7 = 0 (Attached cd)
+}
+
+
+static void
+joypad_write(uint16_t A, uint8_t V)
+{
+	PCE.Joypad.nibble = V & 1;
+	if (V & 2)
+		PCE.Joypad.counter = 0;
+}
+
+
+static uint8_t
+irq_read(uint16_t A)
+{
+	uint8_t ret;
+
+	switch (A & 3) {
+	case 2:
+		return CPU.irq_mask | (PCE.io_buffer & ~INT_MASK);
+	case 3:
+		ret = CPU.irq_lines;
+		CPU.irq_lines = 0;
+		return ret;
+	}
+	return PCE.io_buffer;
+}
+
+
+static void
+irq_write(uint16_t A, uint8_t V)
+{
+	switch (A & 3) {
+	case 2:
+		CPU.irq_mask = V & INT_MASK;
+		pce_schedule();
+		return;
+	case 3:
+		CPU.irq_lines &= ~INT_TIMER;
+		return;
+	}
+
+	open_bus_write(A, V);
+}
+
+
+static uint8_t
+cd_read(uint16_t A)
+{
+	MESSAGE_INFO("CD Emulation not implemented : 0x%04X\n", A);
+	return 0xFF;
+}
+
+
+static void
+cd_write(uint16_t A, uint8_t V)
+{
+	MESSAGE_INFO("CD Emulation not implemented : %d 0x%04X\n", V, A);
+}
+
+
+/**
+  * Cartridge mapper: the banks behind MAP_CART and the Arcade Card registers
+  * at $1A00-$1AFF
+  **/
+static uint8_t
+cart_read(uint16_t A)
+{
+	if (PCE.Mapper && PCE.Mapper->io_read)
+		return PCE.Mapper->io_read(A);
+
+	MESSAGE_INFO("Arcade Card not supported : 0x%04X\n", A);
+	return 0xFF;
+}
+
+
+static void
+cart_write(uint16_t A, uint8_t V)
+{
+	if (PCE.Mapper && PCE.Mapper->io_write) {
+		PCE.Mapper->io_write(A, V);
+		return;
+	}
+
+	MESSAGE_INFO("Arcade Card not supported : %d into 0x%04X\n", V, A);
+}
+
+
+// Register groups of the IO page, by 256-byte region ((A >> 8) & 0x1F)
+static uint8_t (*const io_read_handlers[32])(uint16_t A) = {
+	vdc_read, open_bus_read, open_bus_read, open_bus_read,					// $0000 VDC
+	vce_read, open_bus_read, open_bus_read, open_bus_read,					// $0400 VCE
+	psg_read, io_buffer_read, io_buffer_read, io_buffer_read,				// $0800 PSG
+	timer_read, io_buffer_read, io_buffer_read, io_buffer_read,				// $0C00 Timer
+	joypad_read, io_buffer_read, io_buffer_read, io_buffer_read,			// $1000 Joypad
+	irq_read, io_buffer_read, io_buffer_read, io_buffer_read,				// $1400 IRQ
+	cd_read, open_bus_read, cart_read, open_bus_read,						// $1800 CD-ROM, Arcade Card
+	open_bus_read, open_bus_read, open_bus_read, open_bus_read,				// $1C00
+};
+
+static void (*const io_write_handlers[32])(uint16_t A, uint8_t V) = {
+	vdc_write, open_bus_write, open_bus_write, open_bus_write,				// $0000 VDC
+	vce_write, open_bus_write, open_bus_write, open_bus_write,				// $0400 VCE
+	psg_write, open_bus_write, open_bus_write, open_bus_write,				// $0800 PSG
+	timer_write, open_bus_write, open_bus_write, open_bus_write,			// $0C00 Timer
+	joypad_write, open_bus_write, open_bus_write, open_bus_write,			// $1000 Joypad
+	irq_write, open_bus_write, open_bus_write, open_bus_write,				// $1400 IRQ
+	cd_write, open_bus_write, cart_write, open_bus_write,					// $1800 CD-ROM, Arcade Card
+	open_bus_write, open_bus_write, open_bus_write, open_bus_write,			// $1C00
+};
+
+#define io_buffered(A) (((A) & 0x1FFF) >= 0x0800 && ((A) & 0x1FFF) < 0x1800)
+
+
+inline uint8_t
+pce_readIO(uint16_t A)
+{
+	PROFILE_IO(io_reads, A, 1);
+
+	uint8_t ret = io_read_handlers[(A >> 8) & 0x1F](A);
+
+	TRACE_IO("IO Read %02x at %04x\n", ret, A);
+
+	if (io_buffered(A))
+		PCE.io_buffer = ret;
+
+	return ret;
+}
+
+
+inline void
+pce_writeIO(uint16_t A, uint8_t V)
+{
+	TRACE_IO("IO Write %02x at %04x\n", V, A);
+	PROFILE_IO(io_writes, A, 1);
+
+	if (io_buffered(A))
+		PCE.io_buffer = V;
+
+	io_write_handlers[(A >> 8) & 0x1F](A, V);
+}
+
+
+#if USE_PSRAM_ROM
+/**
+  * PSRAM banks are copied to the bank cache when they're mapped, these only
+  * serve the accesses to a mapped bank that couldn't get a slot
+  **/
+static uint8_t
+psram_bank_read(uint16_t A)
+{
+	uint8_t V;
+	osd_psram_read(PCE.BankStore[PCE.MMR[A >> 13]] + (A & 0x1FFF), &V, 1);
+	return V;
+}
+
+
+static void
+psram_bank_write(uint16_t A, uint8_t V)
+{
+	osd_psram_write(PCE.BankStore[PCE.MMR[A >> 13]] + (A & 0x1FFF), &V, 1);
+}
+#endif
+
+
+static uint8_t (*const map_read_handlers[MAP_MAX])(uint16_t A) = {
+	[MAP_NONE] = open_bus_read,
+	[MAP_IO]   = pce_readIO,
+	[MAP_CART] = cart_read,
+#if USE_PSRAM_ROM
+	[MAP_PSRAM] = psram_bank_read,
+#else
+	[MAP_PSRAM] = open_bus_read,
+#endif
+};
+
+static void (*const map_write_handlers[MAP_MAX])(uint16_t A, uint8_t V) = {
+	[MAP_NONE] = open_bus_write,
+	[MAP_IO]   = pce_writeIO,
+	[MAP_CART] = cart_write,
+#if USE_PSRAM_ROM
+	[MAP_PSRAM] = psram_bank_write,
+#else
+	[MAP_PSRAM] = open_bus_write,
+#endif
+};
+
+
+/**
+  * Map the ROM page at offset (in bytes from ROM_DATA) to a bank, in place
+  * from flash or behind MAP_PSRAM when the image is in PSRAM
+  **/
+void
+pce_map_rom(uint8_t bank, uint32_t offset)
+{
+#if USE_PSRAM_ROM
+	if (!PCE.ROM_DATA) {
+		PCE.MemoryMapR[bank] = NULL;
+		PCE.MemoryHandlerR[bank] = MAP_PSRAM;
+		PCE.BankStore[bank] = PCE.ROM_STORE + offset;
+		return;
+	}
+#endif
+	PCE.MemoryMapR[bank] = PCE.ROM_DATA + offset;
+}
+
+
+/**
+  * Access to the banks without a host pointer (PageR/PageW is NULL),
+  * dispatched to the handler of the bank mapped at A
+  **/
+uint8_t
+pce_readHandler(uint16_t A)
+{
+	return map_read_handlers[pce_handlerR(A)](A);
+}
+
+
+void
+pce_writeHandler(uint16_t A, uint8_t V)
+{
+	map_write_handlers[pce_handlerW(A)](A, V);
 }
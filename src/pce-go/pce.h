@@ -87,6 +87,33 @@ typedef enum {
 
 #define PSG_CHANNELS            6
 
+// Handlers of the banks that aren't accessed through a pointer
+typedef enum {
+	MAP_NONE = 0,		/* Open bus */
+	MAP_IO,				/* Hardware page ($FF) */
+	MAP_CART,			/* Cartridge mapper (mapper_t io_read/io_write) */
+	MAP_PSRAM,			/* Bank in PSRAM without a bank cache slot */
+	MAP_MAX
+} map_handler_t;
+
+
+// Cartridge hardware beyond the ROM (mapper.c), picked by LoadCard from the
+// game database
+typedef struct {
+	const char *name;
+	// Maps banks $00-$7F once the ROM is loaded
+	void (*init)(void);
+	// Accesses to the banks behind MAP_CART and to $1A00-$1AFF, or NULL
+	uint8_t (*io_read)(uint16_t A);
+	void (*io_write)(uint16_t A, uint8_t V);
+	// Applies the mapper registers to the memory map after a reset or a
+	// state load, or NULL
+	void (*remap)(void);
+	// The save states don't hold its registers and RAM: SaveState and
+	// LoadState refuse them while it's active
+	bool no_state;
+} mapper_t;
+
 
 #include "h6280.h"
 
@@ -130,13 +157,26 @@ typedef struct {
 	// Sprite RAM
 	sprite_t SPRAM[64];
 
-	// Extra RAM contained on the HuCard (Populous)
-	uint8_t ExRAM[0x8000];
+	// Extra RAM contained on the HuCard (Populous), in the card arena
+	// unless it's in PSRAM
+	uint8_t *ExRAM;
 
-	// ROM memory
+	// ROM memory, NULL when the image is in PSRAM
 	const uint8_t *ROM;
 	uint8_t *ROM_DATA;
 
+#if USE_PSRAM_ROM
+	// PSRAM address of ROM_DATA and of each MAP_PSRAM bank
+	uint32_t ROM_STORE;
+	uint32_t BankStore[256];
+
+	// PSRAM address of the card RAM, after the ROM
+	uint32_t RAM_STORE;
+#endif
+
+	// Cartridge mapper
+	const mapper_t *Mapper;
+
 	// ROM size in 0x2000 blocks
 	uint16_t ROM_SIZE;
 
@@ -144,7 +184,6 @@ typedef struct {
 	uint32_t ROM_CRC;
 
 	// For performance reasons we trap read/writes to unmapped areas:
-	uint8_t *IOAREA;
 	uint8_t NULLRAM[0x2000];
 
 	// PCE->PC Palette convetion array
@@ -164,13 +203,43 @@ typedef struct {
 	// Run CPU until Cycles >= MaxCycles
 	int32_t MaxCycles;
 
+	// Cycles timestamp of the next event (timer tick, IRQ), ends the CPU slice
+	int32_t NextEvent;
+
+	// Idle loop skipping (off for ROMs flagged NO_IDLE_SKIP)
+	bool IdleSkip;
+
+	// Number of CPU cycles fast-forwarded through idle loops
+	uint32_t IdleCycles;
+
+	// Decoded tile lookups (TILE_CACHE_SIZE)
+	uint32_t TileHits;
+	uint32_t TileMisses;
+
+	// Decoded sprite pattern lookups (SPRITE_CACHE_SIZE)
+	uint32_t SpriteHits;
+	uint32_t SpriteMisses;
+
+	// SRAM bank cache (SRAM_BANK_SLOTS): heat of each bank, raised when it's
+	// mapped and when code runs from its flash copy, and banks copied from
+	// flash or PSRAM
+	uint32_t BankHeat[256];
+	uint32_t BankLoads;
+
+	// Bank cache slots left in the card arena by the card RAM
+	int BankSlots;
+
 	// Value of each of the MMR registers
 	uint8_t MMR[8];
 
-	// Effective memory map
+	// Effective memory map, NULL for the banks behind a handler
 	uint8_t *MemoryMapR[256];
 	uint8_t *MemoryMapW[256];
 
+	// Handler (map_handler_t) of each bank whose MemoryMap entry is NULL
+	uint8_t MemoryHandlerR[256];
+	uint8_t MemoryHandlerW[256];
+
 	// Street Fighter 2 Mapper
 	uint8_t SF2;
 
@@ -231,10 +300,72 @@ typedef struct {
 extern PCE_t PCE;
 #define CPU PCE.CPU
 
-// physical address on emulator machine of each of the 256 banks
+#if ENABLE_PROFILER
+typedef struct
+{
+	// Instructions executed and CPU cycles spent per opcode
+	uint32_t insns[256];
+	uint32_t cycles[256];
+	// Instructions executed per MMR bank and 256-byte page of the bank
+	uint32_t pages[256][32];
+	// pce_readIO/pce_writeIO calls per 256-byte IO region ($0000-$1FFF)
+	uint32_t io_reads[32];
+	uint32_t io_writes[32];
+	// Instructions run from ROM banks, and from their SRAM bank cache copy
+	uint32_t rom_insns;
+	uint32_t sram_insns;
+} pce_profile_t;
+
+extern pce_profile_t Profile;
+
+#define PROFILE_IO(counts, addr, n) Profile.counts[((addr) >> 8) & 0x1F] += (n)
+#else
+#define PROFILE_IO(counts, addr, n) {}
+#endif
+
+// physical address on emulator machine of each of the 256 banks,
+// NULL when the bank is accessed through its handler
 extern uint8_t *PageR[8];
 extern uint8_t *PageW[8];
 
+// Handler of the bank mapped at addr, when PageR/PageW[addr >> 13] is NULL
+#define pce_handlerR(addr) PCE.MemoryHandlerR[PCE.MMR[(addr) >> 13]]
+#define pce_handlerW(addr) PCE.MemoryHandlerW[PCE.MMR[(addr) >> 13]]
+
+// Bank holds ROM (not RAM, unmapped or IO), in flash or in the bank cache
+#define pce_bank_is_rom(bank) (PCE.MemoryMapR[bank] && PCE.MemoryMapR[bank] != PCE.NULLRAM \
+	&& PCE.MemoryMapR[bank] != PCE.MemoryMapW[bank])
+
+// SRAM of the loaded card (see pce_arena_alloc). The bank cache slots, copies
+// of the hottest ROM banks (see bank_cache_update), start at the bottom.
+extern uint8_t CardArena[CARD_ARENA_SIZE];
+
+#if SRAM_BANK_SLOTS
+#define BankCache ((uint8_t (*)[0x2000])CardArena)
+#define pce_bank_in_sram(ptr) ((uintptr_t)(ptr) - (uintptr_t)CardArena < (uintptr_t)PCE.BankSlots * 0x2000)
+#else
+#define pce_bank_in_sram(ptr) (false)
+#endif
+
+#define BANK_HEAT_MAP          16	// Bank cache heat of a pce_bank_set
+
+// Tile number held by each entry of the decoded tile cache (gfx.c), 0xFFFF
+// for none
+#if TILE_CACHE_SIZE
+extern uint16_t TileCacheTag[TILE_CACHE_SIZE];
+#endif
+
+// Same for the sprite pattern cache
+#if SPRITE_CACHE_SIZE
+extern uint16_t SpriteCacheTag[SPRITE_CACHE_SIZE];
+#endif
+
+// Render journal positions (gfx.c), lines queued for the render core
+#if USE_RENDER_CORE
+extern uint32_t RenderJournalHead, RenderJournalTail;
+void gfx_render_sync(void);
+#endif
+
 #define IO_VDC_REG           PCE.VDC.regs
 #define IO_VDC_REG_ACTIVE    PCE.VDC.regs[PCE.VDC.reg]
 #define IO_VDC_REG_INC(reg)  {unsigned _i[] = {1,32,64,128}; PCE.VDC.regs[(reg)].W += _i[(PCE.VDC.regs[CR].W >> 11) & 3];}
@@ -268,9 +399,23 @@ int  pce_init(void);
 void pce_reset(bool hard);
 void pce_term(void);
 void pce_run(void);
+void pce_schedule(void);
 void pce_pause(void);
 void pce_writeIO(uint16_t A, uint8_t V);
 uint8_t pce_readIO(uint16_t A);
+void pce_writeHandler(uint16_t A, uint8_t V);
+uint8_t pce_readHandler(uint16_t A);
+void pce_vdc_write_block(const uint8_t *src, size_t len, int msb);
+void pce_map_rom(uint8_t bank, uint32_t offset);
+void pce_bank_cache_drop(int first, int last, bool restore);
+void pce_arena_reset(void);
+void *pce_arena_alloc(const char *name, size_t size);
+void pce_arena_commit(void);
+size_t pce_memory_report(char *buf, size_t len);
+#if USE_PSRAM_ROM
+void pce_bank_fetch(uint8_t bank);
+#endif
+const mapper_t *pce_mapper_find(uint32_t flags, uint32_t rom_banks);
 
 
 /**
@@ -282,19 +427,20 @@ uint8_t pce_readIO(uint16_t A);
 #define pce_read8(addr) ({							\
 	uint16_t a = (addr); 							\
 	uint8_t *page = PageR[a >> 13]; 				\
-	(page == PCE.IOAREA) ? pce_readIO(a) : page[a]; \
+	page ? page[a] : pce_readHandler(a);			\
 })
 
 #define pce_write8(addr, byte) {					\
 	uint16_t a = (addr), b = (byte); 				\
 	uint8_t *page = PageW[a >> 13]; 				\
-	if (page == PCE.IOAREA) pce_writeIO(a, b); 		\
-	else page[a] = b;								\
+	if (page) page[a] = b; 							\
+	else pce_writeHandler(a, b);					\
 }
 
 #define pce_read16(addr) ({ \
-    uint8_t *page = PageR[addr >> 13];  \
-    page[addr] | (page[addr+1] << 8);   \
+    uint16_t a = (addr); \
+    uint8_t *page = PageR[a >> 13];  \
+    page ? page[a] | (page[a+1] << 8) : pce_readHandler(a) | (pce_readHandler(a+1) << 8); \
 })
 
 #define pce_write161(addr, word) {					\
@@ -309,10 +455,10 @@ pce_read8(uint16_t addr)
 {
 	uint8_t *page = PageR[addr >> 13];
 
-	if (page == PCE.IOAREA)
-		return pce_readIO(addr);
-	else
+	if (page)
 		return page[addr];
+	else
+		return pce_readHandler(addr);
 }
 
 static inline void
@@ -320,16 +466,18 @@ pce_write8(uint16_t addr, uint8_t byte)
 {
 	uint8_t *page = PageW[addr >> 13];
 
-	if (page == PCE.IOAREA)
-		pce_writeIO(addr, byte);
-	else
+	if (page)
 		page[addr] = byte;
+	else
+		pce_writeHandler(addr, byte);
 }
 
 static inline uint16_t
 pce_read16(uint16_t addr)
 {
     uint8_t *page = PageR[addr >> 13];
+    if (!page)
+        return pce_readHandler(addr) | (pce_readHandler(addr + 1) << 8);
     return page[addr] | (page[addr+1] << 8);
 }
 
@@ -348,6 +496,106 @@ pce_bank_set(uint8_t P, uint8_t V)
 	//TRACE_IO("Bank switching (MMR[%d] = %d)\n", P, V);
 
 	PCE.MMR[P] = V;
-	PageR[P] = (PCE.MemoryMapR[V] == PCE.IOAREA) ? (PCE.IOAREA) : (PCE.MemoryMapR[V] - P * 0x2000);
-	PageW[P] = (PCE.MemoryMapW[V] == PCE.IOAREA) ? (PCE.IOAREA) : (PCE.MemoryMapW[V] - P * 0x2000);
+#if SRAM_BANK_SLOTS
+	PCE.BankHeat[V] += BANK_HEAT_MAP;
+#endif
+#if USE_PSRAM_ROM
+	if (!PCE.MemoryMapR[V] && PCE.MemoryHandlerR[V] == MAP_PSRAM)
+		pce_bank_fetch(V);
+#endif
+	PageR[P] = PCE.MemoryMapR[V] ? (PCE.MemoryMapR[V] - P * 0x2000) : NULL;
+	PageW[P] = PCE.MemoryMapW[V] ? (PCE.MemoryMapW[V] - P * 0x2000) : NULL;
+}
+
+
+/**
+  * Points page P at the new MemoryMapR entry of its bank, after a mapper
+  * switched the ROM behind it. PageW and the bank heat stay.
+  **/
+static inline void
+pce_page_refresh(uint8_t P)
+{
+	uint8_t V = PCE.MMR[P];
+
+#if USE_PSRAM_ROM
+	if (!PCE.MemoryMapR[V] && PCE.MemoryHandlerR[V] == MAP_PSRAM)
+		pce_bank_fetch(V);
+#endif
+	PageR[P] = PCE.MemoryMapR[V] ? (PCE.MemoryMapR[V] - P * 0x2000) : NULL;
+}
+
+
+/**
+  * Wait for the render core to draw the lines it has been handed, before
+  * changing VRAM, the palette or the sprites they're drawn from
+  **/
+static inline void
+pce_render_fence(void)
+{
+#if USE_RENDER_CORE
+	if (RenderJournalHead != __atomic_load_n(&RenderJournalTail, __ATOMIC_ACQUIRE))
+		gfx_render_sync();
+#endif
+}
+
+
+/**
+  * Store to VRAM from the VDC (data port, DMA), dropping the decoded copies
+  * of the tile and sprite pattern it's part of
+  **/
+static inline void
+pce_vram_write(uint16_t addr, uint16_t V)
+{
+	pce_render_fence();
+#if TILE_CACHE_SIZE
+	uint16_t tile = addr >> 4;
+	if (TileCacheTag[tile % TILE_CACHE_SIZE] == tile)
+		TileCacheTag[tile % TILE_CACHE_SIZE] = 0xFFFF;
+#endif
+#if SPRITE_CACHE_SIZE
+	uint16_t pattern = addr >> 6;
+	if (SpriteCacheTag[pattern % SPRITE_CACHE_SIZE] == pattern)
+		SpriteCacheTag[pattern % SPRITE_CACHE_SIZE] = 0xFFFF;
+#endif
+	PCE.VRAM[addr] = V;
+}
+
+
+/**
+  * VDC register select and VRAM data port writes ($0000, $0002/$0003 with
+  * VWR selected) without the generic IO decode, for ST0/ST1/ST2 and the
+  * absolute stores to the VDC. Same result as pce_writeIO, returns false
+  * for the other VDC writes which must go through it.
+  **/
+static inline bool
+pce_vdc_write_fast(uint16_t A, uint8_t V)
+{
+	switch (A & 3) {
+	case 0: // Latch
+		PCE.VDC.reg = V & 31;
+		break;
+
+	case 2: // VRAM Write Register (LSB)
+		if (PCE.VDC.reg != VWR)
+			return false;
+		IO_VDC_REG[VWR].B.l = V;
+		break;
+
+	case 3: // VRAM Write Register (MSB)
+		if (PCE.VDC.reg != VWR)
+			return false;
+		if (IO_VDC_REG[MAWR].W < 0x8000) {
+			pce_vram_write(IO_VDC_REG[MAWR].W, (V << 8) | IO_VDC_REG[VWR].B.l);
+		}
+		IO_VDC_REG_INC(MAWR);
+		IO_VDC_REG[VWR].B.h = V;
+		break;
+
+	default:
+		return false;
+	}
+
+	TRACE_IO("IO Write %02x at %04x\n", V, A);
+	PROFILE_IO(io_writes, A, 1);
+	return true;
 }
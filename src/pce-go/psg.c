@@ -75,7 +75,7 @@ psg_update_chan(sample_t *buf, int ch, size_t dwSize)
 				chan->dda_count--;
 			}
 
-			for (int i = 0; i < repeat; i++) {
+			for (int i = 0; i < repeat && buf < buf_end; i++) {
 				*buf++ = (sample * lvol);
 
 				if (stereo) {